@@ -10,15 +10,46 @@
 //=====================================================================//
 #include <cstdint>
 
+/// F_CLK はループ回数の計算で必要で、設定が無いとエラーにします。
+#ifndef F_CLK
+#  error "delay.hpp requires F_CLK to be defined"
+#endif
+
 namespace utils {
 
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	/*!
-		@brief  基準クロック２０ＭＨｚの待ち
+		@brief  システムクロック F_CLK の待ち @n
+				ループ１回（nop １０個とループ処理）を２０クロックとして、 @n
+				回数をコンパイル時に求める。
 	*/
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	struct delay {
 
+		static constexpr uint32_t loop_cycles = 20;
+		static constexpr uint32_t loops_per_ms = F_CLK / loop_cycles / 1000;
+		static_assert(loops_per_ms > 0, "F_CLK too slow for delay loops");
+		static_assert(loops_per_ms <= 1000, "F_CLK too fast for 16 bit delay loops");
+
+	private:
+		static void loop_(uint16_t n) {
+			while(n > 0) {
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				asm("nop");
+				--n;
+			}
+		}
+
+	public:
+
 		//-----------------------------------------------------------------//
 		/*!
 			@brief  ナノ秒単位の待ち
@@ -26,7 +57,7 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		static void nano_second(uint16_t ns) {
-			ns /= 50;   ///< 20MHz clock base
+			ns /= (1000000000 / F_CLK);   ///< nop １個分
 			while(ns > 0) {
 				asm("nop");
 				--ns;
@@ -41,18 +72,10 @@ namespace utils {
 		*/
 		//-----------------------------------------------------------------//
 		static void micro_second(uint16_t us) {
-			while(us > 0) {
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				asm("nop");
-				--us;
+			if constexpr (loops_per_ms % 1000 == 0) {
+				loop_(us * uint16_t(loops_per_ms / 1000));
+			} else {
+				loop_(uint16_t(uint32_t(us) * loops_per_ms / 1000));
 			}
 		}
 
@@ -65,7 +88,7 @@ namespace utils {
 		//-----------------------------------------------------------------//
 		static void milli_second(uint16_t ms) {
 			for(uint16_t i = 0; i < ms; ++i) {
-				micro_second(1000);
+				loop_(loops_per_ms);
 			}
 		}
 	};
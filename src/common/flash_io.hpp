@@ -0,0 +1,141 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	R8C/M110AN, R8C/M120AN グループ・データフラッシュ書き換え @n
+			EW0 モードでソフトウェアコマンドを発行する。データフラッシュの @n
+			書き換え中もプログラム ROM のコードと割り込みはそのまま動く。
+*/
+//=====================================================================//
+#include "common/io_utils.hpp"
+#include "M120AN/flash.hpp"
+
+namespace device {
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  データフラッシュ書き換えクラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	class flash_io {
+	public:
+		static constexpr address_type data_flash_org = 0x3000;	///< ブロックＡの先頭
+		static constexpr uint16_t data_flash_block = 1024;		///< ブロックの大きさ
+		static constexpr uint8_t data_flash_blocks = 2;			///< ブロックＡ、Ｂ
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  データフラッシュのブロック
+		*/
+		//-------------------------------------------------------------//
+		enum class data_area : uint8_t {
+			bank0,	///< ブロックＡ（0x3000 ～ 0x33FF）
+			bank1,	///< ブロックＢ（0x3400 ～ 0x37FF）
+		};
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  書き換え完了を待つ間に呼ぶ関数（監視への応答など）
+		*/
+		//-------------------------------------------------------------//
+		typedef void (*idle_func)();
+
+	private:
+		static constexpr uint8_t CMD_PROGRAM      = 0x40;
+		static constexpr uint8_t CMD_BLOCK_ERASE  = 0x20;
+		static constexpr uint8_t CMD_ERASE_CONFIRM = 0xD0;
+		static constexpr uint8_t CMD_CLEAR_STATUS = 0x50;
+		static constexpr uint8_t CMD_READ_ARRAY   = 0xFF;
+
+		static address_type block_org_(data_area bank) {
+			return data_flash_org + static_cast<uint16_t>(bank) * data_flash_block;
+		}
+
+		// FST7: レディ、FST4: プログラムエラー、FST5: イレーズエラー
+		static bool wait_(idle_func idle) {
+			while(FST.FST7() == 0) {
+				if(idle != nullptr) (*idle)();
+			}
+			bool ok = FST.FST4() == 0 && FST.FST5() == 0;
+			if(!ok) wr8_(data_flash_org, CMD_CLEAR_STATUS);
+			return ok;
+		}
+
+	public:
+		//-------------------------------------------------------------//
+		/*!
+			@brief  CPU 書き換えモード（EW0）に入り、ブロックＡ、Ｂの書き換えを許可する
+		*/
+		//-------------------------------------------------------------//
+		static void start() {
+			FMR0.FMR01 = 0;
+			FMR0.FMR01 = 1;
+			FMR0.FMR02 = 0;
+			FMR1.FMR16 = 1;
+			FMR1.FMR16 = 0;
+			FMR1.FMR17 = 1;
+			FMR1.FMR17 = 0;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  書き換えを禁止し、CPU 書き換えモードを抜ける
+		*/
+		//-------------------------------------------------------------//
+		static void end() {
+			wr8_(data_flash_org, CMD_READ_ARRAY);
+			FMR1.FMR16 = 1;
+			FMR1.FMR17 = 1;
+			FMR0.FMR01 = 0;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  ブロックを消去する（全て 0xFF になる）
+			@param[in]	bank	ブロック
+			@param[in]	idle	完了を待つ間に呼ぶ関数
+			@return 成功なら「true」
+		*/
+		//-------------------------------------------------------------//
+		static bool erase(data_area bank, idle_func idle = nullptr) {
+			address_type org = block_org_(bank);
+			wr8_(org, CMD_BLOCK_ERASE);
+			wr8_(org, CMD_ERASE_CONFIRM);
+			return wait_(idle);
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  書き込む（消去済みの所にだけ書ける）
+			@param[in]	org		書き込み先
+			@param[in]	src		データ
+			@param[in]	len		バイト数
+			@param[in]	idle	完了を待つ間に呼ぶ関数
+			@return 成功なら「true」
+		*/
+		//-------------------------------------------------------------//
+		static bool write(address_type org, const void* src, uint16_t len, idle_func idle = nullptr) {
+			const uint8_t* p = static_cast<const uint8_t*>(src);
+			for(uint16_t i = 0; i < len; ++i) {
+				wr8_(org + i, CMD_PROGRAM);
+				wr8_(org + i, p[i]);
+				if(!wait_(idle)) return false;
+			}
+			return true;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  読み出し用のポインター（読み出しは普通のメモリと同じ）
+			@param[in]	bank	ブロック
+			@return 先頭
+		*/
+		//-------------------------------------------------------------//
+		static const void* data(data_area bank) {
+			return reinterpret_cast<const void*>(block_org_(bank));
+		}
+	};
+}
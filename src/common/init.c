@@ -23,8 +23,23 @@ extern short _preinit_array_start;
 extern short _preinit_array_end;
 extern short _init_array_start;
 extern short _init_array_end;
-extern short _fini_array_start;
-extern short _fini_array_end;
+
+extern short _noinitend;
+extern short usp_init;
+extern short isp_init;
+
+/// 塗りつぶしの時に残す、_init 自身のフレームの分（ワード数）
+#define STACK_PAINT_MARGIN	16
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  起動直後の初期化（何もしない、アプリケーションで置き換える）
+*/
+//-----------------------------------------------------------------//
+void __attribute__((weak)) boot_early(void)
+{
+}
+
 
 //-----------------------------------------------------------------//
 /*!
@@ -33,6 +48,9 @@ extern short _fini_array_end;
 //-----------------------------------------------------------------//
 void _init(void)
 {
+	// 以降の初期化を速いクロックで行えるよう、最初に呼ぶ
+	boot_early();
+
 	{  // R/W-data セクションのコピー
 		short *src = &_datainternal;
 		short *dst = &_datastart;
@@ -48,11 +66,16 @@ void _init(void)
 		}
 	}
 
-	{  // C++ 静的コンストラクターの実行
-		short *p = &_fini_array_start;
-		while(p < &_fini_array_end) {
-			void (*prog)(void) = (void *)*p++;
-			(*prog)();
+	{  // スタックの塗りつぶし（使用量の計測用）
+		// ユーザースタックは、今使っているフレームより下だけ
+		short here;
+		short *dst = &_noinitend;
+		while(dst < (&here - STACK_PAINT_MARGIN)) {
+			*dst++ = STACK_PAINT;
+		}
+		dst = &usp_init;
+		while(dst < &isp_init) {
+			*dst++ = STACK_PAINT;
 		}
 	}
 
@@ -79,4 +102,45 @@ void _init(void)
 	exit(0);
 }
 
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  静的コンストラクターの数
+	@return .preinit_array と .init_array の関数の数
+*/
+//-----------------------------------------------------------------//
+unsigned short get_init_array_count(void)
+{
+	return (&_preinit_array_end - &_preinit_array_start)
+		+ (&_init_array_end - &_init_array_start);
+}
+
+
+static unsigned short unused_bytes_(const short* bottom, const short* top)
+{
+	const short *p = bottom;
+	while(p < top && *p == (short)STACK_PAINT) {
+		++p;
+	}
+	return (p - bottom) * sizeof(short);
+}
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  RAM 使用量の取得
+	@param[out]	u	使用量
+*/
+//-----------------------------------------------------------------//
+void get_ram_usage(ram_usage_t* u)
+{
+	u->data = (char*)&_dataend - (char*)&_datastart;
+	u->bss = (char*)&_bssend - (char*)&_bssstart;
+	u->noinit = (char*)&_noinitend - (char*)&_bssend;
+	u->ustack = (char*)&usp_init - (char*)&_noinitend;
+	u->ustack_unused = unused_bytes_(&_noinitend, &usp_init);
+	u->istack = (char*)&isp_init - (char*)&usp_init;
+	u->istack_unused = unused_bytes_(&usp_init, &isp_init);
+}
+
 // EOF
@@ -18,6 +18,57 @@ extern "C" {
 	*/
 	//-----------------------------------------------------------------//
 	void _init(void);
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  起動直後の初期化 @n
+				_init() が .data/.bss の初期化より前に呼ぶ。電源保持の端子や @n
+				クロックの設定など、リセット直後に急ぐものだけを行う。 @n
+				グローバル変数はまだ初期化されていないので使えない。 @n
+				既定は何もしない（weak）。
+	*/
+	//-----------------------------------------------------------------//
+	void boot_early(void);
+
+
+	/// スタックの塗りつぶしパターン
+#define STACK_PAINT	0x5aa5
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  RAM 使用量（バイト単位）
+	*/
+	//-----------------------------------------------------------------//
+	typedef struct {
+		unsigned short data;			///< .data
+		unsigned short bss;				///< .bss
+		unsigned short noinit;			///< .noinit
+		unsigned short ustack;			///< ユーザースタック（.noinit の後ろから _usp_init まで）
+		unsigned short ustack_unused;	///< ユーザースタックの起動後一度も使われていない量
+		unsigned short istack;			///< 割り込みスタック（_usp_init から _isp_init まで）
+		unsigned short istack_unused;	///< 割り込みスタックの起動後一度も使われていない量
+	} ram_usage_t;
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  RAM 使用量の取得 @n
+				スタックは _init() で塗りつぶしたパターンが残っている量から求める。
+		@param[out]	u	使用量
+	*/
+	//-----------------------------------------------------------------//
+	void get_ram_usage(ram_usage_t* u);
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  静的コンストラクターの数 @n
+				グローバル変数は全て定数初期化するので 0 になる（m120an.ld で確認）。
+		@return .preinit_array と .init_array の関数の数
+	*/
+	//-----------------------------------------------------------------//
+	unsigned short get_init_array_count(void);
 #ifdef __cplusplus
 };
 #endif
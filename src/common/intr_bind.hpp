@@ -0,0 +1,73 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	割り込みのコンパイル時の結び付け @n
+			タスク・クラスの task() を、vect.c のベクターテーブルが指す @n
+			割り込み関数（xxx_intr）の本体に直接展開する。 @n
+			同じベクターを２回結び付けるとコンパイルエラーになる。
+*/
+//=====================================================================//
+#include <cstdint>
+#include "common/vect.h"
+#include "common/section.h"
+#include "common/intr_level.hpp"
+
+namespace device {
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  結び付け済みの印（宣言だけ） @n
+				INTR_BIND / INTR_RESERVE が特殊化を定義するので、 @n
+				同じベクターの２回目は再定義のエラーになる。
+		@param[in]	vec	ベクター番号
+	*/
+	//-----------------------------------------------------------------//
+	template <VECTOR vec> struct intr_bind;
+}
+
+
+/// 割り込み関数に必ず展開されるタスク関数
+#define INTR_TASK __attribute__ ((always_inline)) inline
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  ベクターを使用済みにする（アセンブラで書いた入口など）
+	@param[in]	VEC	device::VECTOR の名前
+*/
+//-----------------------------------------------------------------//
+#define INTR_RESERVE(VEC) \
+	template <> struct device::intr_bind<device::VECTOR::VEC> { \
+		static constexpr device::VECTOR vector = device::VECTOR::VEC; \
+	}
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  タスク・クラスをベクターに結び付ける @n
+			VEC##_intr を定義し、TASK::task() をその中に展開する。
+	@param[in]	VEC		device::VECTOR の名前
+	@param[in]	TASK	static void task() を持つクラス（INTR_TASK にする）
+*/
+//-----------------------------------------------------------------//
+#define INTR_BIND(VEC, TASK) \
+	INTR_RESERVE(VEC); \
+	extern "C" void INTERRUPT_FUNC HOT_FUNC VEC##_intr(void) { TASK::task(); }
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  タスク・クラスをベクターに結び付ける（多重割り込みを許す） @n
+			入口で I フラグを立てるので、より高い優先レベルの割り込みが @n
+			タスクの途中に入れる（IPL が自分のレベルになるので、 @n
+			同じレベル以下と自分自身は入れない）。
+	@param[in]	VEC		device::VECTOR の名前
+	@param[in]	TASK	static void task() を持つクラス（INTR_TASK にする）
+*/
+//-----------------------------------------------------------------//
+#define INTR_BIND_NESTED(VEC, TASK) \
+	INTR_RESERVE(VEC); \
+	extern "C" void INTERRUPT_FUNC HOT_FUNC VEC##_intr(void) { \
+		asm volatile ("fset i" : : : "memory"); \
+		TASK::task(); \
+	}
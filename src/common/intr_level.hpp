@@ -0,0 +1,238 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	割り込み優先レベルの表 @n
+			ベクター毎のレベルを１つの表にまとめ、ILVL0, ILVL2 ～ ILVLE に @n
+			書く値をコンパイル時に求める。同じベクターを２回書いたり、 @n
+			ILVL の無いベクターやレベル０～３以外を書くとコンパイルエラーになる。
+*/
+//=====================================================================//
+#include <cstdint>
+#include "M120AN/intr.hpp"
+
+namespace device {
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  可変ベクター番号（vect.c の variable_vectors_）
+	*/
+	//-----------------------------------------------------------------//
+	enum class VECTOR : uint8_t {
+		BRK = 0,			///< BRK 命令
+		FLASH_READY = 1,	///< フラッシュ・レディ
+		COMP_B1 = 4,		///< コンパレーターB1
+		COMP_B3 = 5,		///< コンパレーターB3
+		TIMER_RC = 7,		///< タイマＲＣ
+		ADC = 14,			///< A/D 変換
+		UART0_TX = 17,		///< UART0 送信
+		UART0_RX = 18,		///< UART0 受信
+		INT2 = 21,			///< /INT2
+		TIMER_RJ = 22,		///< タイマＲＪ２
+		WATCHDOG = 23,		///< 周期タイマ（ウオッチドッグ）
+		TIMER_RB = 24,		///< タイマＲＢ２
+		INT1 = 25,			///< /INT1
+		INT3 = 26,			///< /INT3
+		INT0 = 29,			///< /INT0
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  ILVL レジスタの番号（ベクター番号の半分、ILVL1 は無い）
+		@param[in]	vec	ベクター番号
+		@return ILVL レジスタの番号
+	*/
+	//-----------------------------------------------------------------//
+	static constexpr uint8_t ilvl_index(VECTOR vec) { return uint8_t(vec) >> 1; }
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  ILVL レジスタ内の位置（偶数は B0, B1、奇数は B4, B5）
+		@param[in]	vec	ベクター番号
+		@return ビット位置
+	*/
+	//-----------------------------------------------------------------//
+	static constexpr uint8_t ilvl_shift(VECTOR vec) { return (uint8_t(vec) & 1) ? 4 : 0; }
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  １つのベクターの優先レベル
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct intr_level_t {
+		VECTOR		vec;
+		uint8_t		level;	///< 1 ～ 3（0 は割り込み禁止なので表に書かない）
+		uint8_t		group;	///< 用途の分類（表を使う側で決める）
+		const char*	name;
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  優先レベルの表
+		@param[in]	N	ベクターの数
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <uint8_t N>
+	struct intr_plan_t {
+		intr_level_t	levels[N];
+
+		static constexpr uint8_t size() { return N; }
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  同じベクターが２回あるか
+			@return ２回あれば「true」
+		*/
+		//-------------------------------------------------------------//
+		constexpr bool conflict() const {
+			for(uint8_t i = 0; i < N; ++i) {
+				for(uint8_t j = i + 1; j < N; ++j) {
+					if(levels[i].vec == levels[j].vec) return true;
+				}
+			}
+			return false;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  全てのベクターに ILVL があり、レベルが 1 ～ 3 か
+			@return 正しければ「true」
+		*/
+		//-------------------------------------------------------------//
+		constexpr bool valid() const {
+			for(uint8_t i = 0; i < N; ++i) {
+				uint8_t r = ilvl_index(levels[i].vec);
+				if(r == 0 && levels[i].vec == VECTOR::BRK) return false;
+				if(r == 1 || r > 0xE) return false;
+				if(levels[i].level < 1 || levels[i].level > 3) return false;
+			}
+			return true;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  表の中の位置
+			@param[in]	vec	ベクター番号
+			@return 位置（無い場合 N）
+		*/
+		//-------------------------------------------------------------//
+		constexpr uint8_t index(VECTOR vec) const {
+			for(uint8_t i = 0; i < N; ++i) {
+				if(levels[i].vec == vec) return i;
+			}
+			return N;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  優先レベル
+			@param[in]	vec	ベクター番号
+			@return レベル（表に無い場合 0）
+		*/
+		//-------------------------------------------------------------//
+		constexpr uint8_t level(VECTOR vec) const {
+			uint8_t i = index(vec);
+			return i < N ? levels[i].level : 0;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  分類の中の最低レベル
+			@param[in]	group	分類
+			@return レベル（その分類が無い場合 4）
+		*/
+		//-------------------------------------------------------------//
+		constexpr uint8_t min_level(uint8_t group) const {
+			uint8_t l = 4;
+			for(uint8_t i = 0; i < N; ++i) {
+				if(levels[i].group == group && levels[i].level < l) l = levels[i].level;
+			}
+			return l;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  分類の中の最高レベル
+			@param[in]	group	分類
+			@return レベル（その分類が無い場合 0）
+		*/
+		//-------------------------------------------------------------//
+		constexpr uint8_t max_level(uint8_t group) const {
+			uint8_t l = 0;
+			for(uint8_t i = 0; i < N; ++i) {
+				if(levels[i].group == group && levels[i].level > l) l = levels[i].level;
+			}
+			return l;
+		}
+
+
+		//-------------------------------------------------------------//
+		/*!
+			@brief  ILVL レジスタに書く値
+			@param[in]	r	ILVL レジスタの番号（0, 2 ～ 0xE）
+			@return 値
+		*/
+		//-------------------------------------------------------------//
+		constexpr uint8_t ilvl(uint8_t r) const {
+			uint8_t v = 0;
+			for(uint8_t i = 0; i < N; ++i) {
+				if(ilvl_index(levels[i].vec) == r) {
+					v |= levels[i].level << ilvl_shift(levels[i].vec);
+				}
+			}
+			return v;
+		}
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  優先レベルの表を作る
+		@param[in]	l	各ベクターのレベル
+		@return 表
+	*/
+	//-----------------------------------------------------------------//
+	template <typename... L>
+	static constexpr intr_plan_t<sizeof...(L)> make_intr_plan(L... l)
+	{
+		return intr_plan_t<sizeof...(L)> { { l... } };
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  表の値を ILVL レジスタに書く @n
+				リセット後に１回だけ呼ぶ（表に無いベクターはリセット時の０のまま）。
+		@param[in]	M	優先レベルの表（static constexpr の変数）
+	*/
+	//-----------------------------------------------------------------//
+	template <const auto& M>
+	inline void intr_plan_setup() {
+		static_assert(!M.conflict(), "vector assigned twice");
+		static_assert(M.valid(), "no interrupt level for vector");
+
+		if constexpr (M.ilvl(0x0) != 0) ILVL0 = M.ilvl(0x0);
+		if constexpr (M.ilvl(0x2) != 0) ILVL2 = M.ilvl(0x2);
+		if constexpr (M.ilvl(0x3) != 0) ILVL3 = M.ilvl(0x3);
+		if constexpr (M.ilvl(0x4) != 0) ILVL4 = M.ilvl(0x4);
+		if constexpr (M.ilvl(0x5) != 0) ILVL5 = M.ilvl(0x5);
+		if constexpr (M.ilvl(0x6) != 0) ILVL6 = M.ilvl(0x6);
+		if constexpr (M.ilvl(0x7) != 0) ILVL7 = M.ilvl(0x7);
+		if constexpr (M.ilvl(0x8) != 0) ILVL8 = M.ilvl(0x8);
+		if constexpr (M.ilvl(0x9) != 0) ILVL9 = M.ilvl(0x9);
+		if constexpr (M.ilvl(0xA) != 0) ILVLA = M.ilvl(0xA);
+		if constexpr (M.ilvl(0xB) != 0) ILVLB = M.ilvl(0xB);
+		if constexpr (M.ilvl(0xC) != 0) ILVLC = M.ilvl(0xC);
+		if constexpr (M.ilvl(0xD) != 0) ILVLD = M.ilvl(0xD);
+		if constexpr (M.ilvl(0xE) != 0) ILVLE = M.ilvl(0xE);
+	}
+}
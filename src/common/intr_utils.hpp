@@ -29,5 +29,97 @@ namespace utils {
 		}
 	};
 
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  割り込み許可フラグ（FLG の I ビット）の操作
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct intr_flag {
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  FLG を保存して割り込みを禁止する
+			@return 保存した FLG
+		*/
+		//-----------------------------------------------------------------//
+		static uint16_t save_and_disable() {
+			uint16_t flg;
+			asm volatile ("stc flg,%0\n\tfclr i" : "=r" (flg) : : "memory");
+			return flg;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  保存した FLG で割り込みが許可されていたか
+			@param[in]	flg	保存した FLG
+			@return 許可されていれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		static bool enabled(uint16_t flg) { return (flg & 0x40) != 0; }
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  保存した I ビットに戻す（許可されていた時だけ許可する）
+			@param[in]	flg	保存した FLG
+		*/
+		//-----------------------------------------------------------------//
+		static void restore(uint16_t flg) {
+			if(enabled(flg)) asm volatile ("fset i" : : : "memory");
+		}
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  割り込み禁止区間を計測しない
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct null_intr_watch {
+		static void begin() { }
+		static void end() { }
+	};
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  クリティカル・セクション（スコープの間、割り込みを禁止する） @n
+				入る時の I ビットを保存して出る時に戻すので、入れ子にできる。 @n
+				割り込みを実際に禁止した一番外側だけが WATCH の begin() / end() を呼ぶ。
+		@param[in]	FLAG	割り込み許可フラグの操作
+		@param[in]	WATCH	割り込み禁止区間の計測
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <class FLAG = intr_flag, class WATCH = null_intr_watch>
+	class critical_t {
+		uint16_t	flg_;
+
+	public:
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  コンストラクター（割り込み禁止）
+		*/
+		//-----------------------------------------------------------------//
+		critical_t() : flg_(FLAG::save_and_disable()) {
+			if(FLAG::enabled(flg_)) WATCH::begin();
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  デストラクター（入る前の状態に戻す）
+		*/
+		//-----------------------------------------------------------------//
+		~critical_t() {
+			if(FLAG::enabled(flg_)) WATCH::end();
+			FLAG::restore(flg_);
+		}
+
+		critical_t(const critical_t&) = delete;
+		critical_t& operator = (const critical_t&) = delete;
+	};
+
 }
 
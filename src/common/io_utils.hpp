@@ -361,6 +361,47 @@ namespace device {
 	};
 
 
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  レジスターのフィールド設定（マスクと値の組） @n
+				同じレジスターのフィールドを「|」でまとめ、update() で一度に書き込む。 @n
+				例： update(P1.B2.f(true) | P1.B3.f(false));
+		@param[in]	T	アクセス・クラス
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <class T>
+	struct reg_field_t {
+		typedef typename T::value_type value_type;
+
+		value_type	mask;
+		value_type	value;
+
+		/// 後から指定したフィールドが優先
+		constexpr reg_field_t operator | (const reg_field_t& o) const {
+			return reg_field_t { static_cast<value_type>(mask | o.mask),
+				static_cast<value_type>((value & ~o.mask) | o.value) };
+		}
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  フィールド設定の書き込み @n
+				読み出しと書き込みを１回ずつ行う。全ビットを指定した場合は書き込みだけ。
+		@param[in]	f	フィールド設定
+	*/
+	//-----------------------------------------------------------------//
+	template <class T>
+	static inline void update(const reg_field_t<T>& f) {
+		typedef typename T::value_type value_type;
+		if(f.mask == static_cast<value_type>(~0)) {
+			T::write(f.value);
+		} else {
+			T::write((T::read() & static_cast<value_type>(~f.mask)) | f.value);
+		}
+	}
+
+
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	/*!
 		@brief  Read/Write ビット・アクセス・テンプレート
@@ -385,6 +426,11 @@ namespace device {
 			return static_cast<typename T::value_type>(v) << static_cast<typename T::value_type>(pos);
 		}
 
+		static constexpr reg_field_t<T> f(bool v = true) {
+			return reg_field_t<T> { static_cast<typename T::value_type>(1 << static_cast<uint8_t>(pos)),
+				static_cast<typename T::value_type>(static_cast<typename T::value_type>(v) << static_cast<uint8_t>(pos)) };
+		}
+
 		void operator = (bool v) { set(v); }
 		bool operator () () { return get(); }
 	};
@@ -412,6 +458,11 @@ namespace device {
 			return (((1 << len) - 1) & v) << static_cast<typename T::value_type>(pos);
 		}
 
+		static constexpr reg_field_t<T> f(typename T::value_type v) {
+			return reg_field_t<T> { static_cast<typename T::value_type>(((1 << len) - 1) << static_cast<uint8_t>(pos)),
+				static_cast<typename T::value_type>((((1 << len) - 1) & v) << static_cast<uint8_t>(pos)) };
+		}
+
 		void operator = (typename T::value_type v) const { set(v); }
 		typename T::value_type operator () () const { return get(); }
 	};
@@ -12,6 +12,30 @@
 
 namespace utils {
 
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  端子の設定（コンパイル時の記述用）
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	struct pin_t {
+		uint8_t	port;	///< ポート番号（1, 3, 4）
+		uint8_t	bit;	///< ビット位置
+		uint8_t	sel;	///< 機能選択（port_map の設定項目の値）
+		bool	output;	///< 出力ポート
+		bool	level;	///< 出力の初期値
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  出力ポートにする
+			@param[in]	lvl	出力の初期値
+		*/
+		//-----------------------------------------------------------------//
+		constexpr pin_t out(bool lvl = false) const {
+			return pin_t { port, bit, sel, true, lvl };
+		}
+	};
+
+
 	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
 	/*!
 		@brief  ポートマップクラス
@@ -412,7 +436,192 @@ namespace utils {
 			device::PMH4.P47SEL = static_cast<uint8_t>(t);
 		}
 
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  端子の設定を作る（コンパイル時） @n
+					pin_mux_t に並べて使う。
+			@param[in]	t	設定項目
+			@return 端子の設定
+		*/
+		//-----------------------------------------------------------------//
+		static constexpr pin_t pin(P10 t) { return pin_t { 1, 0, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P11 t) { return pin_t { 1, 1, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P12 t) { return pin_t { 1, 2, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P13 t) { return pin_t { 1, 3, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P14 t) { return pin_t { 1, 4, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P15 t) { return pin_t { 1, 5, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P16 t) { return pin_t { 1, 6, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P17 t) { return pin_t { 1, 7, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P33 t) { return pin_t { 3, 3, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P34 t) { return pin_t { 3, 4, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P35 t) { return pin_t { 3, 5, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P37 t) { return pin_t { 3, 7, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P42 t) { return pin_t { 4, 2, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P45 t) { return pin_t { 4, 5, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P46 t) { return pin_t { 4, 6, static_cast<uint8_t>(t), false, false }; }
+		static constexpr pin_t pin(P47 t) { return pin_t { 4, 7, static_cast<uint8_t>(t), false, false }; }
+
 	};
 	static port_map PORT_MAP;
+
+
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	/*!
+		@brief  端子割り当て表 @n
+				端子の設定を並べ、各レジスタに書く値をコンパイル時に求める。
+		@param[in]	N	端子数
+	*/
+	//+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++//
+	template <uint8_t N>
+	struct pin_mux_t {
+		pin_t	pins[N];
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  同じ端子が２回以上現れるか
+			@return 重複があれば「true」
+		*/
+		//-----------------------------------------------------------------//
+		constexpr bool conflict() const {
+			for(uint8_t i = 0; i < N; ++i) {
+				for(uint8_t j = i + 1; j < N; ++j) {
+					if(pins[i].port == pins[j].port && pins[i].bit == pins[j].bit) return true;
+				}
+			}
+			return false;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  存在する端子と機能だけか
+			@return 正しければ「true」
+		*/
+		//-----------------------------------------------------------------//
+		constexpr bool valid() const {
+			for(uint8_t i = 0; i < N; ++i) {
+				const pin_t& p = pins[i];
+				uint8_t exist = p.port == 1 ? 0xff : p.port == 3 ? 0xb8 : p.port == 4 ? 0xe4 : 0;
+				if(p.bit > 7 || ((exist >> p.bit) & 1) == 0) return false;
+				// 拡張の選択ビットを持つのは P14, P15, P46 だけ
+				bool ext = (p.port == 1 && (p.bit == 4 || p.bit == 5)) || (p.port == 4 && p.bit == 6);
+				if(p.sel > (ext ? 7 : 3)) return false;
+			}
+			return true;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  機能選択レジスタ（PMLn, PMHn）の値
+			@param[in]	port	ポート番号
+			@param[in]	high	PMHn なら「true」
+			@return 値
+		*/
+		//-----------------------------------------------------------------//
+		constexpr uint8_t pm(uint8_t port, bool high) const {
+			uint8_t v = 0;
+			for(uint8_t i = 0; i < N; ++i) {
+				const pin_t& p = pins[i];
+				if(p.port == port && (p.bit >= 4) == high) v |= (p.sel & 3) << ((p.bit & 3) * 2);
+			}
+			return v;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  拡張機能選択レジスタ（PMHnE）の値
+			@param[in]	port	ポート番号
+			@return 値
+		*/
+		//-----------------------------------------------------------------//
+		constexpr uint8_t pme(uint8_t port) const {
+			uint8_t v = 0;
+			for(uint8_t i = 0; i < N; ++i) {
+				const pin_t& p = pins[i];
+				if(p.port == port && p.bit >= 4) v |= (p.sel >> 2) << ((p.bit & 3) * 2);
+			}
+			return v;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  方向レジスタ（PDn）の値
+			@param[in]	port	ポート番号
+			@return 値
+		*/
+		//-----------------------------------------------------------------//
+		constexpr uint8_t pd(uint8_t port) const {
+			uint8_t v = 0;
+			for(uint8_t i = 0; i < N; ++i) {
+				if(pins[i].port == port && pins[i].output) v |= 1 << pins[i].bit;
+			}
+			return v;
+		}
+
+
+		//-----------------------------------------------------------------//
+		/*!
+			@brief  ポートレジスタ（Pn）の値
+			@param[in]	port	ポート番号
+			@return 値
+		*/
+		//-----------------------------------------------------------------//
+		constexpr uint8_t p(uint8_t port) const {
+			uint8_t v = 0;
+			for(uint8_t i = 0; i < N; ++i) {
+				if(pins[i].port == port && pins[i].output && pins[i].level) v |= 1 << pins[i].bit;
+			}
+			return v;
+		}
+	};
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  端子割り当て表を作る
+		@param[in]	pins	端子の設定
+		@return 端子割り当て表
+	*/
+	//-----------------------------------------------------------------//
+	template <class... P>
+	constexpr pin_mux_t<sizeof...(P)> make_pin_mux(P... pins) {
+		return pin_mux_t<sizeof...(P)> { { pins... } };
+	}
+
+
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  端子割り当て表の書き込み（リセット直後に１回） @n
+				機能選択と方向はリセット値（0）から変わるレジスタだけ、 @n
+				ポートレジスタは出力のあるポートだけ（リセット値は不定）、 @n
+				それぞれ１回ずつ丸ごと書く。出力は初期値を決めてから方向を切り替える。
+		@param[in]	M	端子割り当て表
+	*/
+	//-----------------------------------------------------------------//
+	template <const auto& M>
+	inline void pin_mux_setup() {
+		static_assert(!M.conflict(), "pin assigned twice");
+		static_assert(M.valid(), "no such pin or function");
+
+		if constexpr (M.pd(1) != 0) device::P1 = M.p(1);
+		if constexpr (M.pd(3) != 0) device::P3 = M.p(3);
+		if constexpr (M.pd(4) != 0) device::P4 = M.p(4);
+
+		if constexpr (M.pm(1, false) != 0) device::PML1 = M.pm(1, false);
+		if constexpr (M.pm(1, true) != 0) device::PMH1 = M.pm(1, true);
+		if constexpr (M.pme(1) != 0) device::PMH1E = M.pme(1);
+		if constexpr (M.pm(3, false) != 0) device::PML3 = M.pm(3, false);
+		if constexpr (M.pm(3, true) != 0) device::PMH3 = M.pm(3, true);
+		if constexpr (M.pm(4, false) != 0) device::PML4 = M.pm(4, false);
+		if constexpr (M.pm(4, true) != 0) device::PMH4 = M.pm(4, true);
+		if constexpr (M.pme(4) != 0) device::PMH4E = M.pme(4);
+
+		if constexpr (M.pd(1) != 0) device::PD1 = M.pd(1);
+		if constexpr (M.pd(3) != 0) device::PD3 = M.pd(3);
+		if constexpr (M.pd(4) != 0) device::PD4 = M.pd(4);
+	}
 }
 
@@ -0,0 +1,27 @@
+#pragma once
+//=====================================================================//
+/*!	@file
+	@brief	コード配置の指定（m120an.ld の ROM / EXT 領域）
+*/
+//=====================================================================//
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  頻繁に実行する関数（割り込み、測定ループ） @n
+			ROM（0x8000〜）の先頭にまとめて置く。ROM に収まらないと @n
+			m120an.ld の ASSERT でリンクが失敗する。
+*/
+//-----------------------------------------------------------------//
+#define HOT_FUNC __attribute__ ((section (".text.hot")))
+
+
+//-----------------------------------------------------------------//
+/*!
+	@brief  めったに実行しない関数（初期化、コマンド処理、校正、診断） @n
+			EXT（0x10000〜）の .exttext に置く。 @n
+			関数ポインターは16ビットなので、ベクターテーブルに登録したり @n
+			アドレスを取ったりしないこと（直接の呼び出しだけにする）。 @n
+			呼び出し元に埋め込まれないよう noinline にする。
+*/
+//-----------------------------------------------------------------//
+#define COLD_FUNC __attribute__ ((section (".exttext.cold"), noinline, cold))
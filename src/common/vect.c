@@ -102,6 +102,15 @@ void ADC_intr(void) __attribute__((weak));
 void ADC_intr(void) { }
 
 
+void WATCHDOG_intr(void) __attribute__((weak));
+//-----------------------------------------------------------------//
+/*!
+	@brief  周期タイマ（ウオッチドッグ）割り込み
+*/
+//-----------------------------------------------------------------//
+void WATCHDOG_intr(void) { }
+
+
 void UART0_TX_intr(void) __attribute__((weak));
 //-----------------------------------------------------------------//
 /*!
@@ -190,7 +199,7 @@ const void* variable_vectors_[] __attribute__ ((section (".vvec"))) = {
 	null_intr,       NULL,	// (20)
 	INT2_intr,       NULL,	// (21) /INT2
 	TIMER_RJ_intr,   NULL,	// (22) タイマＲＪ２
-	null_intr,       NULL,	// (23) 周期タイマ（ウオッチドッグ）
+	WATCHDOG_intr,   NULL,	// (23) 周期タイマ（ウオッチドッグ）
 
 	TIMER_RB_intr,   NULL,	// (24) タイマＲＢ２
 	INT1_intr,       NULL,	// (25) /INT1
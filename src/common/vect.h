@@ -96,6 +96,14 @@ extern "C" {
 	void TIMER_RJ_intr(void) INTERRUPT_FUNC;
 
 
+	//-----------------------------------------------------------------//
+	/*!
+		@brief  周期タイマ（ウオッチドッグ）割り込み
+	*/
+	//-----------------------------------------------------------------//
+	void WATCHDOG_intr(void) INTERRUPT_FUNC;
+
+
 	//-----------------------------------------------------------------//
 	/*!
 		@brief  UART0 送信割り込み
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "common/port_map.hpp"
+
+// 基板の端子割り当て
+// 表から各レジスタに書く値をコンパイル時に求め、init_device() の最初に
+// utils::pin_mux_setup<board::pins>() で書き込む。
+// 同じ端子を2回書くとコンパイルエラーになる。
+// ここに無い端子はリセット時のまま(入力ポート)。
+
+namespace board {
+
+typedef utils::port_map PM;
+
+static constexpr auto pins = utils::make_pin_mux(
+  PM::pin(PM::P10::AN0),           // A/D 入力+
+  PM::pin(PM::P11::AN1),           // A/D 入力-
+  PM::pin(PM::P12::PORT).out(),    // ブリッジ+ (I-V測定中は TRCIOB)
+  PM::pin(PM::P13::PORT).out(),    // ブリッジ- (I-V測定中は TRCIOC)
+  PM::pin(PM::P14::TXD0),          // UART 送信
+  PM::pin(PM::P15::RXD0),          // UART 受信
+  PM::pin(PM::P17::PORT).out(true),  // 電源保持
+  PM::pin(PM::P37::TRCIOD),        // ブザー
+  PM::pin(PM::P46::PORT).out(),    // LED+
+  PM::pin(PM::P47::PORT).out()     // LED-
+);
+
+}
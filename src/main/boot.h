@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+// 起動時間の記録
+// _init() の最初(boot_early())でF_CLKに切り替えてタイマRJを動かし始めてからの
+// 経過時間を、起動の段階毎に記録する。リリース毎の比較用。
+// tick_millisは.noinitに置いてboot_early()で0にするので、_init()の.bssの初期化で0に戻らない。
+
+enum class BootStage : uint8_t {
+  MAIN,     // main() の開始(.data/.bssの初期化とスタックの塗りつぶしが終わった)
+  MEASURE,  // タイマRCとA/Dの設定が終わった
+  RESULT,   // 最初の測定結果を表示した(導通していればブザーが鳴り始める)
+  UART,     // UARTの設定が終わった
+  READY,    // 監視を始めてリセット要因を送信し、メインループに入る
+};
+
+#define BOOT_STAGE_COUNT 5
+
+struct BootLog {
+  uint32_t us[BOOT_STAGE_COUNT];
+
+  void mark(BootStage s, uint32_t t) {
+    us[uint8_t(s)] = t;
+  }
+
+  // 電源投入から使えるようになるまで
+  uint32_t ready_us() const {
+    return us[uint8_t(BootStage::READY)];
+  }
+};
+
+inline const char* boot_stage_name(BootStage s) {
+  switch (s) {
+    case BootStage::MAIN:
+    return "MAIN";
+
+    case BootStage::MEASURE:
+    return "MEASURE";
+
+    case BootStage::RESULT:
+    return "RESULT";
+
+    case BootStage::UART:
+    return "UART";
+
+    default:
+    return "READY";
+  }
+}
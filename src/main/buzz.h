@@ -1,8 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include "clock_config.h"
+
+// ブザーの音程。電圧が低いほど高い音にする。
+// タイマRC(PWM)の周期[f1のカウント]を返す。実際の音はTONE_*_HZの半分の周波数になる。
+#define TONE_MAX_HZ 4000
+#define TONE_MIN_HZ 30
+
+// 最も低い音もf32で16ビットに収まること(buzz()がカウントソースを選ぶ)
+static_assert(uint32_t(F_CLK) * 2 / TONE_MIN_HZ / 32 <= UINT16_MAX, "lowest tone does not fit timer RC at F_CLK");
 
 inline uint32_t to_count(uint16_t voltage) {
-  uint32_t hz = uint32_t(4000) - uint32_t(4000 - 30) * voltage / 500;
-  return uint32_t(10000) * 4000 / hz;
+  uint32_t hz = uint32_t(TONE_MAX_HZ) - uint32_t(TONE_MAX_HZ - TONE_MIN_HZ) * voltage / 500;
+  return uint32_t(F_CLK) * 2 / hz;
 }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include "resistance.h"
+
+// 校正値の保存
+// データフラッシュの1ブロックに、校正する度に記録を後ろへ追記する(消去はブロックが埋まった時だけ)。
+// 起動時は最後の有効な記録を使う。書き込み中に電源が切れた記録はcheckが合わないので、その前のものを使う。
+// 有効な記録が1つも無ければ(未書き込み・壊れている)CALIBRATION_DEFAULTのまま。
+
+#define CALIBRATION_RECORD_MAGIC 0xCA
+#define CALIBRATION_RECORD_VERSION 2  // Calibrationの中身を変えたら上げる
+
+struct CalibrationRecord {
+  uint8_t magic;
+  uint8_t version;
+  Calibration cal;
+  uint16_t check;  // magicからcalまでの16bit毎の和の反転
+};
+
+static_assert(sizeof(CalibrationRecord) % 2 == 0, "calibration record must be word sized");
+
+inline uint16_t calibration_check(const CalibrationRecord& r) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&r);
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < sizeof(CalibrationRecord) - sizeof(r.check); i += 2)
+    sum += uint16_t(p[i]) | (uint16_t(p[i + 1]) << 8);
+  return uint16_t(~sum);
+}
+
+inline CalibrationRecord make_calibration_record(const Calibration& cal) {
+  CalibrationRecord r = { CALIBRATION_RECORD_MAGIC, CALIBRATION_RECORD_VERSION, cal, 0 };
+  r.check = calibration_check(r);
+  return r;
+}
+
+// 開放時の値が短絡時より大きく、10bitの範囲に収まり、Vccが分かっていれば校正値として使える
+inline bool is_valid_calibration(const Calibration& cal) {
+  return cal.shorted < cal.open && cal.open <= to_oversample_scale((1 << AD_BITS) - 1) && cal.vcc_mv != 0;
+}
+
+inline bool is_valid_record(const CalibrationRecord& r) {
+  return r.magic == CALIBRATION_RECORD_MAGIC && r.version == CALIBRATION_RECORD_VERSION
+    && r.check == calibration_check(r) && is_valid_calibration(r.cal);
+}
+
+// 消去されたまま(全て0xFF)か
+inline bool is_blank_record(const CalibrationRecord& r) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&r);
+  for (uint8_t i = 0; i < sizeof(CalibrationRecord); ++i) {
+    if (p[i] != 0xff)
+      return false;
+  }
+  return true;
+}
+
+// 次に書く位置。埋まっていればn
+inline uint16_t calibration_free_slot(const CalibrationRecord* slots, uint16_t n) {
+  uint16_t i = 0;
+  while (i < n && ! is_blank_record(slots[i]))
+    ++i;
+  return i;
+}
+
+// 最後の有効な記録を読む。無ければfalseでcalはそのまま
+inline bool load_calibration(const CalibrationRecord* slots, uint16_t n, Calibration& cal) {
+  for (uint16_t i = calibration_free_slot(slots, n); 0 < i; --i) {
+    if (is_valid_record(slots[i - 1])) {
+      cal = slots[i - 1].cal;
+      return true;
+    }
+  }
+  return false;
+}
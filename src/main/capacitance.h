@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include "resistance.h"
+
+#define CHARGE_DELTA 24  // これ以上上昇していれば充電中 (OVERSAMPLE_BITSスケール, 約15mV)
+
+// 放電したコンデンサを充電し始めると、測定点は短絡時の値Vsから開放時の値Voへ
+// 時定数 Rs * C で近付く。63.2% (1 - 1/e) に達した時間が時定数になる。
+inline uint16_t charge_threshold(const Calibration& cal) {
+  if (cal.open <= cal.shorted)
+    return cal.open;
+  return cal.shorted + uint16_t(uint32_t(cal.open - cal.shorted) * 632 / 1000);
+}
+
+// 時定数[ns] / Rs[Ω] = C[nF]
+inline uint32_t to_nanofarad(uint32_t tau_ns) {
+  return tau_ns / SENSE_OHMS;
+}
+
+// 極性切り替え後の途中の値と最後の値から、コンデンサを充電中かを判定する
+inline bool is_charging(uint16_t early, uint16_t late) {
+  return early + CHARGE_DELTA < late;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+
+// クロック設定
+// システムクロック f(= f1) は F_CLK [Hz] で決まる。SConstruct が既定の20MHzを定義し、
+// F_CLK=5000000 scons のように変えられる。高速オンチップオシレータ(20MHz)を SCKCR.PHISSEL で
+// 分周して作るので、20MHz / 2^n だけ選べる。
+// タイマ、UART、待ちループ、ブザーの設定値は全て F_CLK からコンパイル時に求め、
+// 作れない周期やボーレートは static_assert で止める。
+
+#ifndef F_CLK
+#  error "clock_config.h requires F_CLK to be defined"
+#endif
+
+#define HOCO_HZ 20000000  // 高速オンチップオシレータ
+
+// SCKCR.PHISSEL (分周比 2^n, n = 0..6)。作れない周波数は7
+constexpr uint8_t clock_phissel(uint32_t f) {
+  for (uint8_t n = 0; n < 7; ++n) {
+    if ((uint32_t(HOCO_HZ) >> n) == f)
+      return n;
+  }
+  return 7;
+}
+
+static_assert(clock_phissel(F_CLK) < 7, "F_CLK must be 20MHz divided by 1, 2, 4, ... or 64");
+
+// UART0 のクロック(U0C0.CLK)とビットレート(U0BRG)
+// ビットレート = f / 分周比 / 16 / (brg + 1)
+struct UartSetting {
+  uint8_t clk;    // 0: f1, 1: f8, 2: f32, 3: 作れない
+  uint8_t brg;
+  uint32_t baud;  // 実際のビットレート
+};
+
+#define UART_MAX_ERROR_PERMILLE 25  // 調歩同期で許せる誤差(2.5%)
+
+// baudに最も近い設定。細かく合わせられるよう分周比の小さい方から探す
+constexpr UartSetting uart_setting(uint32_t f, uint32_t baud) {
+  const uint8_t divs[3] = { 1, 8, 32 };
+  for (uint8_t clk = 0; clk < 3; ++clk) {
+    uint32_t base = f / divs[clk] / 16;
+    uint32_t n = (base + baud / 2) / baud;
+    if (1 <= n && n <= 256)
+      return UartSetting { clk, uint8_t(n - 1), base / n };
+  }
+  return UartSetting { 3, 0, 0 };
+}
+
+// 実際のビットレートの誤差[0.1%]
+constexpr uint32_t uart_error_permille(uint32_t baud, UartSetting s) {
+  uint32_t d = s.baud < baud ? baud - s.baud : s.baud - baud;
+  return d * 1000 / baud;
+}
+
+constexpr bool uart_reachable(uint32_t f, uint32_t baud) {
+  return uart_setting(f, baud).clk < 3 && uart_error_permille(baud, uart_setting(f, baud)) <= UART_MAX_ERROR_PERMILLE;
+}
+
+// 誤差無く作れるか(高速モードは誤差の余裕が無いので、これだけ使う)
+constexpr bool uart_exact(uint32_t f, uint32_t baud) {
+  const uint8_t divs[3] = { 1, 8, 32 };
+  UartSetting s = uart_setting(f, baud);
+  return s.clk < 3 && uint64_t(divs[s.clk]) * 16 * (s.brg + 1) * baud == f;
+}
+
+// タイマRB(タイマモード)のカウントソースと周期
+// 周期 = 分周比 * (pre + 1) * (pr + 1) / f
+struct TimerRbSetting {
+  uint8_t tck;  // TRBMR.TCK (0: f1, 3: f2, 1: f8)
+  uint8_t div;  // 分周比, 0: 作れない
+  uint8_t pre;
+  uint8_t pr;
+
+  constexpr uint32_t counts() const {
+    return uint32_t(div) * (pre + 1) * (pr + 1);
+  }
+};
+
+// f1でcountsカウントの周期に最も近い設定。細かく合わせられるよう分周比の小さい方から探す
+constexpr TimerRbSetting timer_rb_setting(uint32_t counts) {
+  const uint8_t tcks[3] = { 0, 3, 1 };
+  const uint8_t divs[3] = { 1, 2, 8 };
+  for (uint8_t i = 0; i < 3; ++i) {
+    uint32_t c = (counts + divs[i] / 2) / divs[i];
+    if (c == 0 || uint32_t(256) * 256 < c)
+      continue;
+
+    TimerRbSetting best = { tcks[i], divs[i], 0, 0 };
+    uint32_t best_err = UINT32_MAX;
+    for (uint32_t p = 1; p <= 256; ++p) {
+      uint32_t q = (c + p / 2) / p;
+      if (q < 1 || 256 < q)
+        continue;
+      uint32_t n = p * q;
+      uint32_t err = n < c ? c - n : n - c;
+      if (err < best_err) {
+        best_err = err;
+        best.pre = uint8_t(p - 1);
+        best.pr = uint8_t(q - 1);
+      }
+    }
+    return best;
+  }
+  return TimerRbSetting { 0, 0, 0, 0 };
+}
+
+// 周期の誤差[ppm]
+constexpr uint32_t timer_rb_error_ppm(uint32_t counts, TimerRbSetting s) {
+  uint32_t n = s.counts();
+  uint32_t d = n < counts ? counts - n : n - counts;
+  return uint32_t(uint64_t(d) * 1000000 / counts);
+}
+
+// 時間[us]をf1のカウント数にする(コンパイル時用)
+constexpr uint32_t clock_counts_us(uint32_t us) {
+  return uint32_t(uint64_t(F_CLK) * us / 1000000);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// UARTから受け取る1行分のコマンド。
+// 先頭1文字がコマンド名、続く10進数字が引数 (例: "O4\r")。
+struct Command {
+  char name;
+  uint16_t arg;
+  bool has_arg;
+};
+
+class CommandReader {
+  Command cmd_ = { 0, 0, false };
+
+public:
+  // 1文字ずつ渡し、行末(CR/LF)でコマンドが揃ったらtrueを返す。
+  bool feed(char c, Command& out) {
+    if (c == '\r' || c == '\n') {
+      if (cmd_.name == 0) return false;
+      out = cmd_;
+      cmd_ = Command { 0, 0, false };
+      return true;
+    }
+
+    if (cmd_.name == 0) {
+      if (c != ' ') cmd_.name = c;
+    } else if ('0' <= c && c <= '9') {
+      cmd_.arg = cmd_.arg * 10 + (c - '0');
+      cmd_.has_arg = true;
+    }
+    return false;
+  }
+};
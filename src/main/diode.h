@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include "resistance.h"
+
+// 順方向電圧による大まかな分類(約9mAで駆動した時の値)
+enum class DiodeClass : uint8_t {
+  UNKNOWN,
+  SCHOTTKY,              // 〜450mV
+  SILICON,               // 〜900mV
+  LED_RED_YELLOW,        // 1.5V〜2.3V
+  LED_GREEN_BLUE_WHITE,  // 2.3V〜3.6V
+};
+
+// 導通側の測定値から順方向電圧[mV]を求める。
+// 測定点の電圧からブリッジのオン抵抗R0による電圧降下 I * R0 を差し引く。
+//   I = (Vcc - Vnode) / Rs,  R0 = Rs * Vs / (Vo - Vs)
+//   Vf = Vnode - (Vcc - Vnode) * Vs / (Vo - Vs)
+// node: 測定点の電圧[mV]、drive: ブリッジの駆動電圧[mV]
+inline uint16_t forward_node_millivolt(uint32_t node, uint32_t drive, const Calibration& cal) {
+  if (cal.open <= cal.shorted)
+    return 0;
+
+  if (drive <= node)
+    return uint16_t(drive);
+
+  uint32_t drop = (drive - node) * cal.shorted / (cal.open - cal.shorted);
+  return node <= drop ? 0 : uint16_t(node - drop);
+}
+
+inline uint16_t forward_millivolt(uint16_t v, const Calibration& cal, uint16_t vcc_mv) {
+  if (cal.open <= cal.shorted)
+    return 0;
+
+  return forward_node_millivolt(uint32_t(vcc_mv) * v / cal.open, vcc_mv, cal);
+}
+
+inline DiodeClass classify_diode(uint16_t mv) {
+  if (mv < 100) return DiodeClass::UNKNOWN;
+  if (mv < 450) return DiodeClass::SCHOTTKY;
+  if (mv < 900) return DiodeClass::SILICON;
+  if (mv < 1500) return DiodeClass::UNKNOWN;
+  if (mv < 2300) return DiodeClass::LED_RED_YELLOW;
+  if (mv < 3600) return DiodeClass::LED_GREEN_BLUE_WHITE;
+  return DiodeClass::UNKNOWN;
+}
+
+inline const char* diode_class_name(DiodeClass c) {
+  switch (c) {
+    case DiodeClass::SCHOTTKY:
+    return "SCHOTTKY";
+
+    case DiodeClass::SILICON:
+    return "SI";
+
+    case DiodeClass::LED_RED_YELLOW:
+    return "LED-RY";
+
+    case DiodeClass::LED_GREEN_BLUE_WHITE:
+    return "LED-GBW";
+
+    default:
+    return "?";
+  }
+}
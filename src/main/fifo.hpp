@@ -27,9 +27,18 @@ namespace utils {
 		volatile PTS	get_ = 0;
 		volatile PTS	put_ = 0;
 
-		DT	buff_[SIZE];
+		DT	buff_[SIZE] = { };
 
 	public:
+        //-----------------------------------------------------------------//
+        /*!
+            @brief  コンストラクター @n
+					定数初期化されるので、静的コンストラクターを作らない。
+        */
+        //-----------------------------------------------------------------//
+		constexpr fifo() = default;
+
+
         //-----------------------------------------------------------------//
         /*!
             @brief  クリア
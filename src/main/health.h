@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+
+// メインループの監視
+// ループの各段階は通過する度にチェックインする(ビットを立てるだけ)。
+// 通常は全段階が揃う度にウォッチドッグをリフレッシュし、揃わなければハードウェアでリセットされる。
+// その後はmissing_stage()で揃わなかった段階が分かる。
+// スニフモード中は周期タイマ割り込み毎に Supervisor::tick() でまとめて確認し、
+// 期限内にチェックインしなかった段階があれば、その段階を返す。
+
+enum class Stage : uint8_t {
+  ACQUIRE,    // 測定
+  CLASSIFY,   // 導通・ダイオード等の判定
+  ACTUATE,    // LED・ブザー
+  TELEMETRY,  // UARTコマンド
+};
+
+#define STAGE_COUNT 4
+#define STAGE_NONE 0xff
+#define STAGE_ALL ((1 << STAGE_COUNT) - 1)
+
+constexpr uint8_t stage_bit(Stage s) {
+  return uint8_t(1) << uint8_t(s);
+}
+
+// 期限[周期タイマの周期]。スイープ等の長いコマンドの間は測定が止まるので、その分の余裕を持たせる。
+static const uint8_t stage_deadlines[STAGE_COUNT] = { 4, 4, 4, 8 };
+
+class Supervisor {
+  uint8_t missed_[STAGE_COUNT] = { 0 };
+
+public:
+  // 前回からのチェックインのビットを渡す。期限切れの段階があればそれを、無ければSTAGE_NONEを返す。
+  uint8_t tick(uint8_t checkins) {
+    for (uint8_t s = 0; s < STAGE_COUNT; ++s) {
+      if (checkins & (1 << s))
+        missed_[s] = 0;
+      else if (stage_deadlines[s] <= ++missed_[s])
+        return s;
+    }
+    return STAGE_NONE;
+  }
+};
+
+// チェックインが無かった最初の段階。全て揃っていればSTAGE_NONE
+inline uint8_t missing_stage(uint8_t checkins) {
+  for (uint8_t s = 0; s < STAGE_COUNT; ++s) {
+    if (! (checkins & (1 << s)))
+      return s;
+  }
+  return STAGE_NONE;
+}
+
+inline const char* stage_name(uint8_t s) {
+  switch (Stage(s)) {
+    case Stage::ACQUIRE:
+    return "ACQUIRE";
+
+    case Stage::CLASSIFY:
+    return "CLASSIFY";
+
+    case Stage::ACTUATE:
+    return "ACTUATE";
+
+    case Stage::TELEMETRY:
+    return "TELEMETRY";
+
+    default:
+    return "?";
+  }
+}
+
+// リセット後も消えないRAM(.noinit)に置く記録。
+// 電源投入直後は中身が不定なので、magicが一致した時だけ信用する。
+#define RESET_RECORD_MAGIC 0x5a17
+
+struct ResetRecord {
+  uint16_t magic;
+  uint8_t stage;  // 監視でリセットした時の段階。それ以外はSTAGE_NONE
+  uint8_t count;  // 監視によるリセットの回数
+};
+
+// 起動時に呼ぶ。不定なら初期化し、直前の監視リセットの段階を返して記録を空にする。
+inline uint8_t take_reset_stage(ResetRecord& r) {
+  if (r.magic != RESET_RECORD_MAGIC) {
+    r.magic = RESET_RECORD_MAGIC;
+    r.stage = STAGE_NONE;
+    r.count = 0;
+  }
+  uint8_t s = r.stage;
+  r.stage = STAGE_NONE;
+  return s;
+}
+
+inline void record_reset(ResetRecord& r, uint8_t stage) {
+  r.magic = RESET_RECORD_MAGIC;
+  r.stage = stage;
+  ++r.count;
+}
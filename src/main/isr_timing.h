@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// 割り込み処理毎の応答時間と実行時間 [タイマRJのカウント、20MHzで50ns]
+// 応答時間は割り込み要求が出てから処理に入るまでで、要求の時刻が分かる周期タイマ(RJ, RB)だけ測る。
+// 実行時間は入口から出口までで、より高いレベルに割り込まれていた時間も含む。
+
+struct IsrTiming {
+  uint32_t count;
+  uint16_t max_latency;
+  uint16_t max_exec;
+  bool has_latency;
+
+  void latency(uint16_t c) {
+    has_latency = true;
+    if (max_latency < c)
+      max_latency = c;
+  }
+
+  void exec(uint16_t c) {
+    ++count;
+    if (max_exec < c)
+      max_exec = c;
+  }
+};
+
+// タイマRB(タイマモード)のアンダーフローからの経過[カウントソースのカウント]
+// pre_reload/pr_reload はTRBPRE/TRBPRに書いた値、pre/pr はその時に読んだカウンタの値
+inline uint16_t timer_rb_elapsed(uint8_t pre_reload, uint8_t pr_reload, uint8_t pre, uint8_t pr) {
+  return uint16_t(pr_reload - pr) * (pre_reload + 1) + (pre_reload - pre);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include "diode.h"
+
+// I-V特性の1点
+struct IvPoint {
+  uint16_t millivolt;  // 被測定物の両端電圧 (ブリッジのオン抵抗分を除く)
+  uint16_t microamp;   // 流れた電流 (最大 5V / 330Ω = 15mA)
+};
+
+// PWMの1周期で平均した測定点の電圧(A/D値)から、電圧と電流の周期平均を求める。
+// 駆動電圧もデューティ比で平均し(vcc_mv * on / period)、ブリッジのオン抵抗の補正はその値で行う。
+// オフ期間は両端とも0Vなので、平滑されない場合でも平均はオン期間の動作点をデューティ比倍したものになり、
+// 式が線形なのでこのまま正しい。平滑される場合は、そのデューティ比での直流の動作点になる。
+inline IvPoint to_iv_point(uint16_t v, const Calibration& cal, uint16_t vcc_mv, uint16_t on, uint16_t period) {
+  uint32_t drive = uint32_t(vcc_mv) * on / period;
+  uint32_t node = cal.open ? uint32_t(vcc_mv) * v / cal.open : drive;
+  uint16_t ua = node < drive ? uint16_t((drive - node) * 1000 / SENSE_OHMS) : 0;
+  return IvPoint { forward_node_millivolt(node, drive, cal), ua };
+}
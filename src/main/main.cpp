@@ -2,63 +2,228 @@
 
 #include "fifo.hpp"
 #include "common/vect.h"
+#include "common/init.h"
+#include "common/section.h"
+#include "common/intr_bind.hpp"
+#include "common/intr_utils.hpp"
 #include "r8c-m1xa-io.h"
 #include "clock.h"
+#include "clock_config.h"
 #include "buzz.h"
+#include "command.h"
+#include "oversample.h"
+#include "mains.h"
+#include "resistance.h"
+#include "diode.h"
+#include "iv.h"
+#include "calib_store.h"
+#include "capacitance.h"
+#include "tick.h"
+#include "supply.h"
+#include "sniff.h"
+#include "health.h"
+#include "stats.h"
+#include "trace.h"
+#include "profile.h"
+#include "board.h"
+#include "boot.h"
+#include "uart_link.h"
+#include "priority.h"
+#include "isr_timing.h"
+#include "common/delay.hpp"
+#include "common/flash_io.hpp"
+#include "M120AN/adc.hpp"
+#include "M120AN/clock.hpp"
+#include "M120AN/intr.hpp"
+#include "M120AN/port.hpp"
+#include "M120AN/system.hpp"
+#include "M120AN/timer_rb.hpp"
+#include "M120AN/timer_rc.hpp"
+#include "M120AN/uart.hpp"
+#include "M120AN/vdetect.hpp"
+#include "M120AN/watchdog.hpp"
+#include "common/port_map.hpp"
+
+#define TRACE_SIZE 64
+
+#define AUTO_POWER_OFF_MILLIS (uint32_t(10) * 60 * 1000)
+
+// ADMOD.MD
+#define ADMOD_MD_ONE_SHOT 0
+#define ADMOD_MD_REPEAT0 2
+
+// ADMOD.ADCAP
+#define ADMOD_ADCAP_SOFTWARE 0  // ADSTで変換開始
+
+// A/D変換プロファイル。変換クロック、ブリッジ切り替え後のサンプリングまでの待ち、
+// オーバーサンプリング時の変換モードをまとめて切り替える。
+struct AdProfile {
+  char name;
+  ADMOD_CKS cks;
+  bool repeat;        // true: 繰り返しモード0で連続変換, false: 1回毎にADSTで開始
+  uint8_t settle_ms;  // 極性切り替えから変換開始までの待ち
+};
 
-#define AUTO_POWER_OFF_MILLIS (int32_t(10) * 60 * 1000)
+static const AdProfile ad_profiles[] = {
+  { 'F', ADMOD_CKS::F1, true, 2 },    // 最速
+  { 'B', ADMOD_CKS::F2, true, 10 },   // 標準
+  { 'A', ADMOD_CKS::F4, false, 20 },  // 高精度
+};
 
-Clock<InternalClock20M> clock(InternalClock20M {
-  SCKCR_PHISSEL::DIV_1
-});
+#define AD_PROFILE_COUNT (sizeof(ad_profiles) / sizeof(ad_profiles[0]))
+#define AD_PROFILE_DEFAULT 1
 
 typedef utils::fifo<uint8_t, 16> TX_BUFF;  // 送信バッファ
 typedef utils::fifo<uint8_t, 16> RX_BUFF;  // 受信バッファ
 
+// グローバル変数は全て定数初期化し、静的コンストラクタを作らない(m120an.ldで確認)。
+// _init() はF_CLKに切り替える前の遅いクロックで動くため、その分起動が遅れる。
+
 static TX_BUFF send_buf;
 static RX_BUFF recv_buf;
 static volatile bool send_stall;
+static Stats stats;
+static BootLog boot_log;
 
-static void isend() {
-  if (send_buf.length()) {
-    io.u0tbl = send_buf.get();
-  } else {
-    send_stall = true;
-  }
+// 監視によるリセットの前の様子を見られるよう、トレースは.noinitに置く
+static TraceBuffer<TRACE_SIZE> trace_buf __attribute__((section(".noinit")));
 
-  io.u0ir.bits.is_tx_itr_requested = false;
+static inline void trace(uint8_t id) {
+  trace_buf.record(id, now_stamp());
 }
 
-static void irecv() {
-  u0rb_t u0rb = io.u0rb.clone();
-  if (u0rb.b8.is_ovr_err || u0rb.b8.is_frm_err || u0rb.b8.is_prity_err || u0rb.b8.is_sum_err) {
-    io.u0c1.clr_err();
-  } else {
-    recv_buf.put(u0rb.recv_b8());
+// UART割り込みは1バイト毎(1.25Mbpsでは8us毎)に入るので、毎回タイムスタンプを取るには重い。
+// TRACE_UART=1 sconsでビルドした時だけ記録する。
+static inline void trace_uart(uint8_t id) {
+#ifdef TRACE_UART
+  trace(id);
+#endif
+}
+
+// 割り込みと共有する変数はCriticalのスコープの中で触る。入れ子にしてよい。
+// INSTRUMENTを定義する(INSTRUMENT=1 scons)と、割り込み禁止区間の最長をTコマンドで見られる。
+#ifdef INSTRUMENT
+struct IntrOffWatch {
+  static inline TickMark begin_;
+
+  static void begin() {
+    begin_ = tick_mark();
   }
 
-  io.u0ir.bits.is_rx_itr_requested = false;
-}
+  static void end() {
+    uint16_t d = tick_elapsed(begin_, tick_mark());
+    if (stats.max_intr_off_counts < d)
+      stats.max_intr_off_counts = d;
+  }
+};
+typedef utils::critical_t<utils::intr_flag, IntrOffWatch> Critical;
+#else
+typedef utils::critical_t<> Critical;
+#endif
 
-extern "C" {
-  void UART0_TX_intr(void) {
-    isend();
+// 割り込み処理毎の応答時間と実行時間。Iコマンドで見る。
+// タイマRJの割り込みは.bssの初期化より前から記録するので、.noinitに置いてboot_early()で0にする。
+static IsrTiming isr_timings[priority::plan.size()] __attribute__((section(".noinit")));
+
+// 割り込み処理の最初に置き、スコープを出る時に実行時間を記録する
+template <device::VECTOR V>
+struct IsrScope {
+  static constexpr uint8_t index = priority::plan.index(V);
+  static_assert(index < priority::plan.size(), "vector has no priority");
+
+  TickMark begin_;
+
+  IsrScope() : begin_(tick_mark()) { }
+
+  ~IsrScope() {
+    isr_timings[index].exec(tick_elapsed(begin_, tick_mark()));
   }
 
-  void UART0_RX_intr(void) {
-    irecv();
+  void latency(uint16_t c) {
+    isr_timings[index].latency(c);
   }
 };
 
-static void resume_tx() {
-  if (send_stall && send_buf.length() > 0) {
-    while (! io.u0c1.bits.is_tx_buf_empty) {
-      asm("nop");
+// 割り込み処理は INTR_BIND でベクターの割り込み関数に直接展開する。
+// 優先レベルは priority.h の表で決め、通信は測定に割り込まれてよいよう INTR_BIND_NESTED にする。
+
+// UART0 送信: 次の1バイトを送る。無ければ止めて、resume_tx() で再開する。
+struct UartTxIntr {
+  static INTR_TASK void task() {
+    IsrScope<device::VECTOR::UART0_TX> scope;
+    trace_uart(TRACE_UART_TX);
+    if (send_buf.length()) {
+      io.u0tbl = send_buf.get();
+    } else {
+      send_stall = true;
+    }
+
+    io.u0ir.bits.is_tx_itr_requested = false;
+    trace_uart(TRACE_UART_TX | TRACE_END);
+  }
+};
+INTR_BIND_NESTED(UART0_TX, UartTxIntr)
+
+// 受信エラー(フレーミング・オーバーラン・パリティ)の数。高速モードの監視用で、一周してよい。
+static volatile uint8_t uart_errors;
+
+// UART0 受信
+struct UartRxIntr {
+  static INTR_TASK void task() {
+    IsrScope<device::VECTOR::UART0_RX> scope;
+    trace_uart(TRACE_UART_RX);
+    u0rb_t u0rb = io.u0rb.clone();
+    if (u0rb.b8.is_ovr_err || u0rb.b8.is_frm_err || u0rb.b8.is_prity_err || u0rb.b8.is_sum_err) {
+      if (u0rb.b8.is_ovr_err)
+        ++stats.overruns;
+      else
+        ++stats.framing_errors;
+      uart_errors = uart_errors + 1;
+      io.u0c1.clr_err();
+    } else if (recv_buf.size() - 1 <= recv_buf.length()) {
+      ++stats.overruns;  // 満杯のFIFOに入れると古いデータを上書きしてしまう
+    } else {
+      ++stats.rx_bytes;
+      recv_buf.put(u0rb.recv_b8());
     }
-    uint8_t c = send_buf.get();
+
+    io.u0ir.bits.is_rx_itr_requested = false;
+    trace_uart(TRACE_UART_RX | TRACE_END);
+  }
+};
+INTR_BIND_NESTED(UART0_RX, UartRxIntr)
+
+// boot_early()でタイマRJを動かす前に0にする。.bssだと_init()が途中で0に戻してしまう。
+volatile uint32_t tick_millis __attribute__((section(".noinit")));
+
+struct TickIntr {
+  static INTR_TASK void task() {
+    // アンダーフローで再設定された値からの減り分が応答時間
+    uint16_t c = device::TRJ();
+    IsrScope<device::VECTOR::TIMER_RJ> scope;
+    scope.latency(TICK_COUNTS_PER_MS - 1 - c);
+    tick_isr();
+  }
+};
+INTR_BIND(TIMER_RJ, TickIntr)
+
+static void resume_tx() {
+  // 送信割り込みがsend_stallを立てるのと入れ違いにならないよう、判定と取り出しだけを割り込み禁止にする
+  uint8_t c;
+  {
+    Critical cs;
+    if (! send_stall || send_buf.length() == 0)
+      return;
+    c = send_buf.get();
     send_stall = false;
-    io.u0tbl = c;
   }
+
+  // 止まっている間は送信割り込みが来ないので、ここからは割り込みを許可したままでよい。
+  // UARTが止まってここから抜けない時は、監視(TELEMETRY)が検出する。
+  while (! io.u0c1.bits.is_tx_buf_empty) {
+    asm("nop");
+  }
+  io.u0tbl = c;
 }
 
 void uart_putc(uint8_t c) {
@@ -69,6 +234,7 @@ void uart_putc(uint8_t c) {
     }
   }
   send_buf.put(c);
+  ++stats.tx_bytes;
   resume_tx();
 }
 
@@ -92,6 +258,27 @@ static void print_uint16(uint16_t i) {
   uart_putc('0' + i);
 }
 
+static void print_str(const char* s) {
+  while (*s) {
+    uart_putc(*s++);
+  }
+}
+
+static void print_hex(uint16_t v, uint8_t digits) {
+  while (digits--) {
+    uint8_t d = (v >> (digits * 4)) & 0xf;
+    uart_putc(d < 10 ? '0' + d : 'a' + d - 10);
+  }
+}
+
+static void print_uint32(uint32_t i) {
+  uint16_t upper = i / 100000;
+  if (upper) {
+    print_uint16(upper);
+  }
+  print_uint16(i % 100000);
+}
+
 /*
 static void print(uint16_t p, uint16_t m) {
   print_uint16(p);
@@ -102,19 +289,20 @@ static void print(uint16_t p, uint16_t m) {
 }
 */
 
-void init_uart() {
-  // UART の設定 (P1_4: TXD0[out], P1_5: RXD0[in])
-  // ※シリアルライターでは、RXD 端子は、P1_6 となっているので注意！
-  io.pm1.bits.b4_func = PM1_B4_FUNC::TXD0;
-  io.pmh1e.bits.is_b4_trciob = false;
-
-  io.pm1.bits.b5_func = PM1_B5_FUNC::RXD0;
-  io.pmh1e.bits.is_b5_vcout1 = false;
+// 20MHzでは f1, U0BRG = 10 で 113636bps (誤差1.4%)。遅いクロックでは UART_BAUD=38400 scons のように下げる。
+#ifndef UART_BAUD
+#define UART_BAUD 115200
+#endif
+static_assert(uart_reachable(F_CLK, UART_BAUD), "UART_BAUD is not reachable at F_CLK");
+static constexpr UartSetting uart_default = uart_setting(F_CLK, UART_BAUD);
 
+void COLD_FUNC init_uart() {
+  // UART の設定 (端子は board.h の P1_4: TXD0[out], P1_5: RXD0[in])
+  // ※シリアルライターでは、RXD 端子は、P1_6 となっているので注意！
   io.mstcr.bits.is_uart_standby = false;
 
-  io.u0c0.bits.clk_div = U0C0_CLK::DIV1;
-  io.u0brg = 10;
+  io.u0c0.bits.clk_div = U0C0_CLK(uart_default.clk);
+  io.u0brg = uart_default.brg;
 
   io.u0mr.set(u0mr_t()
                 .with_smd(U0MR_SMD::BIT_LEN8)
@@ -122,15 +310,8 @@ void init_uart() {
 
   io.u0c1.set(u0c1_t().with_tx_enabled(true).with_rx_enabled(true));
 
-  io.ilvl8.bits.uart_tx = ITR_LEVEL::LEVEL_1;
-  io.ilvl9.bits.uart_rx = ITR_LEVEL::LEVEL_1;
-
   io.u0ir.set(u0ir_t().with_rx_itr_enabled(true).with_tx_itr_enabled(true));
 
-  io.pm3.bits.b7_func = PM3_B7_FUNC::TRCIOD;
-  io.mstcr.bits.is_tmr_rc_standby = false;
-  io.trcmr.bits.is_count_started = true;
-
   send_stall = true;
 }
 
@@ -207,68 +388,236 @@ void init_uart() {
 // 結果読み出し:
 //   AD1
 
-static void init_device() {
-  clock.init(&io);
-  init_uart();
+static const AdProfile* ad_profile;
+
+static void apply_ad_profile(uint8_t n) {
+  ad_profile = &ad_profiles[n];
+  device::ADMOD = device::ADMOD.CKS.b(uint8_t(ad_profile->cks))
+    | device::ADMOD.MD.b(ADMOD_MD_ONE_SHOT)
+    | device::ADMOD.ADCAP.b(ADMOD_ADCAP_SOFTWARE);
+}
 
-  io.pd1.set(
-    io.pd1.clone()
-      .with_p1_7(PD_DIR::OUT)
-      .with_p1_2(PD_DIR::OUT)
-      .with_p1_3(PD_DIR::OUT)
-  );
-
-  io.pd4.set(
-    io.pd4.clone()
-      .with_p4_6(PD_DIR::OUT)
-      .with_p4_7(PD_DIR::OUT)
-  );
-
-  io.trcoer.set(
-    io.trcoer.clone().with_trciob(TRCOER_E::DISABLED_OR_HIGH_IMP).with_trciod(TRCOER_E::ENABLED)
-  );
-  io.trcmr.set(
-    io.trcmr.clone()
-      .with_trciob(TRCMR_MODE::TIMER).with_trcioc(TRCMR_MODE::TIMER)
-      .with_trciod(TRCMR_MODE::PWM).with_pwm2(TRCMR_MODE2::TIMER_OR_PWM)
-  );
-  io.trcior0.set(
-    io.trcior0.clone()
-      .with_trcgra_ctrl(TRCIOR0_CTRL::OUT_COMP_DISABLED)
-      .with_trcgrb_ctrl(TRCIOR0_CTRL::OUT_COMP_DISABLED)
-  );
+// リセット直後、_init() が.data/.bssを初期化する前に呼ばれる。
+// グローバル変数は、ここで初期化する.noinitのもの(tick_millis, isr_timings)しか使えない。
+// 電源ボタンを離しても切れないよう最初に電源保持(P1_7)を出力し、
+// 以降の初期化を速く終えるためF_CLK(既定20MHz)に切り替える。
+// 起動時間(U BOOT)の0はここでタイマRJを動かし始めた時点で、リセットからここまでの時間は含まない。
+extern "C" void boot_early() {
+  utils::pin_mux_setup<board::pins>();  // 電源保持もここで出力する
+  // 設定を渡すだけなので、グローバルにせず(静的コンストラクタになる)ここで作る
+  Clock<InternalClock20M>(InternalClock20M { SCKCR_PHISSEL(clock_phissel(F_CLK)) }).init(&io);
+  device::intr_plan_setup<priority::plan>();
+  tick_millis = 0;
+  for (uint8_t i = 0; i < priority::plan.size(); ++i)
+    isr_timings[i] = IsrTiming();
+  init_tick();
+}
+
+static void boot_stage(BootStage s) {
+  boot_log.mark(s, tick_counts_to_us(now_counts()));
+}
+
+// 最初の測定に必要なもの(ブザーとA/D)だけを設定する。UART等はその後。
+static void COLD_FUNC init_measure() {
+  io.mstcr.bits.is_tmr_rc_standby = false;
+  io.trcmr.bits.is_count_started = true;
+
+  // TRCIOB出力禁止、TRCIOD出力許可(TRCOERは1で禁止)
+  device::update(device::TRCOER.EB.f(true) | device::TRCOER.ED.f(false));
+  // B, Cはタイマ、DはPWM、PWM2モードは使わない(PWM2=1)
+  device::update(device::TRCMR.PWMB.f(false) | device::TRCMR.PWMC.f(false)
+    | device::TRCMR.PWMD.f(true) | device::TRCMR.PWM2.f(true));
+  // TRCGRA, TRCGRBはアウトプットコンペア、端子出力なし
+  device::update(device::TRCIOR0.IOA.f(0) | device::TRCIOR0.IOB.f(0));
   io.trcior1.bits.trcgrc_ctrl = TRCIOR1_TRCGRC_CTRL::OUT_COMP_TRCIOA_DISABLED;
   io.trccr1.bits.trccnt_clear_mode = TRCCR1_CLEAR_MODE::CLEAR;
   io.trcmr.bits.is_count_started = false;
 
   // A/D
   io.mstcr.bits.is_ad_standby = false;
-  io.admod.bits.cks = ADMOD_CKS::F1;
+  apply_ad_profile(AD_PROFILE_DEFAULT);
   io.adinsel.set(adinsel_t().with_ch0(1).with_adgsel(ADINSEL_ADGSEL::AN0_1));
 }
 
-static void set_output(bool plus) {
-  io.p1.set(
-    io.p1.clone().with_b2(plus).with_b3(! plus)
-  );
+// ブリッジの両側を1回の読み書きで切り替える
+static void HOT_FUNC set_output(bool plus) {
+  device::update(device::P1.B2.f(plus) | device::P1.B3.f(! plus));
+}
+
+// テスタ棒の両側を0にする(テスタ棒間を短絡)
+static void clear_output() {
+  device::update(device::P1.B2.f(false) | device::P1.B3.f(false));
 }
 
-uint16_t ad() {
+static void HOT_FUNC set_leds(bool plus, bool minus) {
+  device::update(device::P4.B6.f(plus) | device::P4.B7.f(minus));
+}
+
+uint16_t HOT_FUNC ad() {
+  ++stats.conversions;
   io.adcon0.ad_starts = true;
   while (io.adcon0.ad_starts) {
     asm("nop");
   }
+  trace(TRACE_AD_DONE);
 
   return io.ad1;
 }
 
+static uint8_t oversample_log2 = 4;  // 16回
+
+// 繰り返しモード0で変換し続け、終了フラグ毎に結果を積算してから間引く。
+// 戻り値はOVERSAMPLE_BITSビットのスケール。
+static uint16_t HOT_FUNC ad_oversampled() {
+  uint8_t n = uint8_t(1) << oversample_log2;
+  uint16_t sum = 0;
+
+  if (! ad_profile->repeat) {
+    while (n--) {
+      sum += ad();
+    }
+    return decimate(sum, oversample_log2);
+  }
+
+  device::ADMOD.MD = ADMOD_MD_REPEAT0;
+  device::ADICSR.ADF = false;
+  io.adcon0.ad_starts = true;
+  while (n--) {
+    while (! device::ADICSR.ADF()) {
+      asm("nop");
+    }
+    device::ADICSR.ADF = false;
+    trace(TRACE_AD_DONE);
+    sum += io.ad1;
+  }
+  io.adcon0.ad_starts = false;
+  device::ADMOD.MD = ADMOD_MD_ONE_SHOT;
+  stats.conversions += uint8_t(1) << oversample_log2;
+
+  return decimate(sum, oversample_log2);
+}
+
+// 電源周期同期モード
+// タイマRBの割り込み毎に1回変換し、SyncIntegratorで1周期分積分する。
+// 極性の切り替えも割り込み内で行うので、main()は結果が揃ったかを見るだけで良い。
+//
+// タイマRBの割り込みはプロファイラのサンプリングにも使う。電源周期同期モードの間はその周期で、
+// それ以外はPROFILE_TRBPRE/PROFILE_TRBPRの周期で割り込ませる。
+
+static uint8_t mains_hz;  // 0: 無効, 50, 60
+static SyncIntegrator mains_integrator;
+static volatile bool mains_ready;
+static uint16_t mains_plus;
+static uint16_t mains_minus;
+
+static bool profiling;
+static ProfileHistogram profile;
+static TimerRbSetting trb;  // 動かしている周期(応答時間の計算用)
+
+extern "C" {
+  // 割り込まれたPC。割り込み直後のスタックは [SP]: PCL, PCM, FLGL, FLGH(上位4bit) | PCH(下位4bit)
+  volatile uint16_t profile_pc;
+  volatile uint8_t profile_pch;
+
+  void timer_rb_isr(void) INTERRUPT_FUNC;
+};
+
+// TIMER_RB_intrの入口。レジスタを退避する前にスタック上のPCを拾ってから、Cの割り込み関数へ飛ぶ。
+// アセンブラで書くのでINTR_BINDは使わず、ベクターだけ使用済みにする。
+INTR_RESERVE(TIMER_RB);
+asm(
+  "\t.pushsection\t.text.hot,\"ax\"\n"
+  "\t.global\t_TIMER_RB_intr\n"
+  "_TIMER_RB_intr:\n"
+  "\tmov.w\t0[sp],_profile_pc\n"
+  "\tmov.b\t3[sp],_profile_pch\n"
+  "\tjmp.a\t_timer_rb_isr\n"
+  "\t.popsection\n"
+);
+
+extern "C" {
+  void HOT_FUNC timer_rb_isr(void) {
+    // カウンタを読む途中でプライマリが減ったら読み直す
+    uint8_t pr, pre;
+    do {
+      pr = device::TRBPR();
+      pre = device::TRBPRE();
+    } while (pr != device::TRBPR());
+    IsrScope<device::VECTOR::TIMER_RB> scope;
+    scope.latency(timer_rb_elapsed(trb.pre, trb.pr, pre, pr) * trb.div);  // f1のカウントにする
+
+    trace(TRACE_TIMER_RB);
+    if (profiling)
+      profile.record((uint32_t(profile_pch & 0x0f) << 16) | profile_pc);
+
+    if (mains_hz) {
+      bool plus = mains_integrator.is_plus();
+      uint16_t p, m;
+      if (mains_integrator.feed(ad(), p, m)) {
+        mains_plus = p;
+        mains_minus = m;
+        mains_ready = true;
+      }
+      if (mains_integrator.is_plus() != plus)
+        set_output(mains_integrator.is_plus());
+    }
+
+    device::TRBIR.TRBIF = false;
+    trace(TRACE_TIMER_RB | TRACE_END);
+  }
+};
+
+// 電源周期同期モードとプロファイラの状態に合わせてタイマRBを動かす
+static void start_timer_rb() {
+  device::TRBCR.TSTART = false;
+  device::TRBIR = 0;
+
+  if (mains_hz) {
+    trb = mains_timing(mains_hz);
+    mains_integrator.reset();
+    mains_ready = false;
+    set_output(mains_integrator.is_plus());
+  } else if (profiling) {
+    trb = PROFILE_TIMING;
+  } else {
+    return;
+  }
+
+  device::MSTCR.MSTTRB = false;
+  device::TRBMR = device::TRBMR.TCK.b(trb.tck);  // タイマモード
+  device::TRBPRE = trb.pre;
+  device::TRBPR = trb.pr;
+  device::TRBIR = device::TRBIR.TRBIE.b();
+  device::TRBCR.TSTART = true;
+}
+
+static void start_mains(uint8_t hz) {
+  mains_hz = hz;
+  start_timer_rb();
+}
+
+static bool HOT_FUNC mains_fetch(uint16_t& plus, uint16_t& minus) {
+  if (! mains_ready)
+    return false;
+
+  Critical cs;
+  plus = mains_plus;
+  minus = mains_minus;
+  mains_ready = false;
+  return true;
+}
+
+static Calibration calibration = CALIBRATION_DEFAULT;
+
+// 導通の閾値。校正値と測定したVccからon_threshold_for()で求め、どちらかが変わる度に更新する。
+static uint16_t on_threshold = to_oversample_scale(ON_THRESHOLD);
+
 static inline bool is_on(uint16_t v) {
-  return v < 800;
+  return v < on_threshold;
 }
 
-static void disp(uint16_t pv, uint16_t mv) {
-  io.p4.bits.b6 = is_on(pv);
-  io.p4.bits.b7 = is_on(mv);
+static void HOT_FUNC disp(uint16_t pv, uint16_t mv) {
+  set_leds(is_on(pv), is_on(mv));
 }
 
 static uint32_t current_count() {
@@ -298,8 +647,9 @@ static uint16_t changed_percent(uint32_t before, uint32_t after) {
   return diff * 100 / before;
 }
 
-static void buzz(uint16_t v) {
+static void HOT_FUNC buzz(uint16_t v) {
   if (is_on(v)) {
+    v >>= OVERSAMPLE_BITS - AD_BITS;
     if (v < 300) v = 300;
     v -= 300;  // 0 <= v < 500
 
@@ -308,6 +658,8 @@ static void buzz(uint16_t v) {
     uint32_t diff_percent = changed_percent(new_cnt, cur_cnt);
 
     if (0 < diff_percent) {
+      ++stats.retunes;
+      trace(TRACE_RETUNE);
       io.trcmr.bits.is_count_started = false;
 
       io.trccr1.bits.source = TRCCR1_SOURCE::F1;
@@ -353,33 +705,1144 @@ static void power_off() {
   io.p1.bits.b7 = false;
 }
 
-int main(int argc, char *argv[]) {
-  init_device();
-  io.p1.bits.b7 = true;
+// 電源監視
+// 電圧検出1の検出レベルを切り替えながらVccを二分探索する。
+// 電池が減るとDC/DCが5Vを保てなくなるので、Vccの低下を電池の残量低下とみなす。
+
+#define SUPPLY_CHECK_MILLIS 1000
+#define VDET1_STABLE_US 100
+
+static uint16_t vcc_millivolt = VCC_MILLIVOLT;
+
+static void update_on_threshold() {
+  on_threshold = on_threshold_for(calibration, vcc_millivolt);
+}
+
+static SupplyState supply_state_now = SupplyState::OK;
+static uint32_t supply_checked_millis;
+
+static bool vdet1_above(uint8_t level) {
+  device::PRCR.PRC3 = true;
+  device::VCA2.VC1E = false;
+  device::VD1LS = level;
+  device::VCA2.VC1E = true;
+  device::PRCR.PRC3 = false;
+
+  utils::delay::micro_second(VDET1_STABLE_US);
+  return device::VW1C.VW1C3();  // Vcc >= Vdet1
+}
+
+static void print_supply() {
+  print_str("BAT ");
+  print_str(supply_state_name(supply_state_now));
+  uart_putc(' ');
+  print_uint16(vcc_millivolt);
+  print_str("mV\r\n");
+}
+
+static void check_supply(uint32_t t) {
+  if (t - supply_checked_millis < SUPPLY_CHECK_MILLIS)
+    return;
+  supply_checked_millis = t;
+
+  vcc_millivolt = estimate_vcc(vdet1_above);
+  update_on_threshold();
+  SupplyState s = supply_state(vcc_millivolt);
+  if (s == supply_state_now)
+    return;
+
+  supply_state_now = s;
+  print_supply();
+  if (s == SupplyState::CRITICAL)
+    power_off();
+}
+
+// 現在の設定を1行で出力する
+static void COLD_FUNC print_status() {
+  print_str("P ");
+  uart_putc(ad_profile->name);
+  print_str(" O ");
+  print_uint16(uint16_t(1) << oversample_log2);
+  print_str(" M ");
+  print_uint16(mains_hz);
+  print_str(" T ");
+  print_uint32(now());
+  print_str("\r\n");
+  print_supply();
+}
+
+// 監視へのチェックイン。各段階が通過した印のビットを立て、全段階が揃ったらウォッチドッグをリフレッシュする。
+// ウォッチドッグのリセットで止まった段階が分かるよう、.noinitに置く。
+// スニフモード中(watchdog_periodic)は周期タイマ割り込みがビットを確かめるので、ここではリフレッシュしない。
+static volatile uint8_t health_checkins __attribute__((section(".noinit")));
+static bool watchdog_periodic;
+
+static inline void watchdog_refresh() {
+  device::WDTR = 0x00;
+  device::WDTR = 0xff;
+}
 
-  io.p4.bits.b6 = true;
-  io.p4.bits.b7 = true;
+static inline void check_in(uint8_t stages) {
+  uint8_t c = health_checkins | stages;
+  if (c == STAGE_ALL && ! watchdog_periodic) {
+    watchdog_refresh();
+    c = 0;
+  }
+  health_checkins = c;
+}
+
+// 1周期(約131ms)を超えるコマンドの途中で、進んでいる間だけ呼ぶ
+static void keep_alive() {
+  check_in(STAGE_ALL);
+}
 
-  int32_t auto_power_off_timer_millis = AUTO_POWER_OFF_MILLIS;
+static char calibration_request;  // 'O': 開放, 'S': 短絡, 0: 無し
+static bool resistance_streaming;
+
+// C0: 開放時の値を校正値に取り込む(テスタ棒を離しておく)
+// C1: 短絡時の値を校正値に取り込む(テスタ棒を接触させておく)
+// 引数無しなら現在の校正値を表示する。
+static void COLD_FUNC set_calibration(const Command& cmd) {
+  if (cmd.has_arg) {
+    if (1 < cmd.arg) {
+      print_str("ERR\r\n");
+      return;
+    }
+    calibration_request = cmd.arg == 0 ? 'O' : 'S';
+    return;
+  }
+
+  print_str("C ");
+  print_uint16(calibration.open);
+  uart_putc(' ');
+  print_uint16(calibration.shorted);
+  uart_putc(' ');
+  print_uint16(calibration.vcc_mv);
+  print_str("mV\r\n");
+}
+
+// 校正値はデータフラッシュのブロックAに追記する(calib_store.h)
+#define CALIBRATION_AREA device::flash_io::data_area::bank0
+#define CALIBRATION_SLOTS (device::flash_io::data_flash_block / sizeof(CalibrationRecord))
+
+static const CalibrationRecord* calibration_slots() {
+  return static_cast<const CalibrationRecord*>(device::flash_io::data(CALIBRATION_AREA));
+}
+
+// 起動時に保存した校正値を読む。無ければCALIBRATION_DEFAULTのまま
+static void COLD_FUNC load_saved_calibration() {
+  load_calibration(calibration_slots(), CALIBRATION_SLOTS, calibration);
+}
+
+// ブロックが埋まっていれば消去してから、次の位置に書く
+static bool COLD_FUNC save_calibration() {
+  CalibrationRecord r = make_calibration_record(calibration);
+  uint16_t slot = calibration_free_slot(calibration_slots(), CALIBRATION_SLOTS);
+
+  // 消去には数百msかかるので、待つ間も監視に応答する
+  device::flash_io::start();
+  bool ok = true;
+  if (slot == CALIBRATION_SLOTS) {
+    ok = device::flash_io::erase(CALIBRATION_AREA, keep_alive);
+    slot = 0;
+  }
+  if (ok) {
+    ok = device::flash_io::write(device::flash_io::data_flash_org + slot * sizeof(CalibrationRecord), &r, sizeof(r), keep_alive);
+  }
+  device::flash_io::end();
+  return ok;
+}
 
+static void COLD_FUNC capture_calibration(uint16_t v) {
+  if (calibration_request == 'O') {
+    calibration.open = v;
+  } else {
+    calibration.shorted = v;
+    calibration.vcc_mv = vcc_millivolt;
+  }
+  update_on_threshold();
+  calibration_request = 0;
+  if (! is_valid_calibration(calibration) || ! save_calibration())
+    print_str("C UNSAVED\r\n");
+  set_calibration(Command { 'C', 0, false });
+}
+
+// R1: 測定毎に抵抗値[mΩ]を送信する。R0で停止。
+static void COLD_FUNC set_resistance_streaming(const Command& cmd) {
+  resistance_streaming = cmd.has_arg && cmd.arg != 0;
+}
+
+static void print_resistance(uint16_t v) {
+  uint32_t r = to_milliohm(v, calibration);
+  print_str("R ");
+  if (r == RESISTANCE_OPEN)
+    print_str("OPEN");
+  else
+    print_uint32(r);
+  print_str("\r\n");
+}
+
+static bool diode_reporting;
+
+// D1: ダイオード(片側だけ導通)を検出したら順方向電圧と種類を送信する。D0で停止。
+static void COLD_FUNC set_diode_reporting(const Command& cmd) {
+  diode_reporting = cmd.has_arg && cmd.arg != 0;
+}
+
+// "D + 01873mV LED-RY" (+: プラス側で導通)
+static void report_diode(uint16_t pv, uint16_t mv) {
+  bool plus = is_on(pv);
+  if (plus == is_on(mv))
+    return;
+
+  uint16_t f = forward_millivolt(plus ? pv : mv, calibration, vcc_millivolt);
+  print_str(plus ? "D + " : "D - ");
+  print_uint16(f);
+  print_str("mV ");
+  print_str(diode_class_name(classify_diode(f)));
+  print_str("\r\n");
+}
+
+// I-Vスイープ
+// ブリッジの駆動側をタイマRCのPWM(P1_2: TRCIOB, P1_3: TRCIOC)で断続させ、
+// デューティ比を変えながら測定点の平均電圧を測る。
+// 基板にはブリッジ出力の平滑コンデンサが無いので、測定点はPWMの周期で変化する。
+// A/D変換の開始をタイマRCのカウンタに合わせてPWMの周期内に均等にずらし、周期平均を求める
+// (繰り返しモードでは変換時間と周期の比によって特定の位相に偏る)。
+// 被測定物側の容量(または後付けのRC)で平滑されない場合、結果はオン期間の動作点をデューティ比倍したものになる。
+
+#define IV_PWM_HZ 100000
+#define IV_PWM_PERIOD (F_CLK / IV_PWM_HZ)  // 20MHzで200
+#define IV_STEPS 8
+static_assert(IV_PWM_PERIOD >= 2 * IV_STEPS, "I-V PWM too coarse at F_CLK");
+#define IV_SETTLE_MS 5
+
+// PWMの1周期を 2^oversample_log2 等分した位相で1回ずつ変換して平均する
+static uint16_t COLD_FUNC iv_ad_averaged() {
+  uint8_t n = uint8_t(1) << oversample_log2;
+  uint16_t sum = 0;
+  for (uint8_t k = 0; k < n; ++k) {
+    uint16_t phase = uint16_t((uint32_t(IV_PWM_PERIOD) * k) >> oversample_log2);
+    // カウンタが0に戻るのを待ってから、phaseを過ぎた所で開始する
+    uint16_t prev = device::TRCCNT();
+    for (;;) {
+      uint16_t c = device::TRCCNT();
+      if (c < prev)
+        break;
+      prev = c;
+    }
+    while (device::TRCCNT() < phase) {
+      asm("nop");
+    }
+    sum += ad();
+  }
+  return decimate(sum, oversample_log2);
+}
+
+static void COLD_FUNC iv_sweep_polarity(bool plus) {
+  // 駆動しない側は0に固定し、駆動側をPWM出力に切り替える
+  clear_output();
+  if (plus)
+    utils::PORT_MAP(utils::port_map::P12::TRCIOB);
+  else
+    utils::PORT_MAP(utils::port_map::P13::TRCIOC);
+
+  for (uint8_t step = 1; step <= IV_STEPS; ++step) {
+    keep_alive();
+    uint16_t on = uint16_t(IV_PWM_PERIOD) * step / IV_STEPS;
+    // TRCGRB/Cの一致からTRCGRAの一致までがアクティブ
+    uint16_t gr = on < IV_PWM_PERIOD ? IV_PWM_PERIOD - on : 0;
+    if (plus)
+      device::TRCGRB = gr;
+    else
+      device::TRCGRC = gr;
+
+    utils::delay::milli_second(IV_SETTLE_MS);
+    IvPoint pt = to_iv_point(iv_ad_averaged(), calibration, vcc_millivolt, on, IV_PWM_PERIOD);
+
+    uart_putc(plus ? '+' : '-');
+    uart_putc('0' + step);
+    uart_putc(' ');
+    print_uint16(pt.millivolt);
+    uart_putc(' ');
+    print_uint16(pt.microamp);
+    print_str("\r\n");
+  }
+
+  utils::PORT_MAP(utils::port_map::P12::PORT);
+  utils::PORT_MAP(utils::port_map::P13::PORT);
+}
+
+// V: I-Vスイープを実行し、"<極性><段階> <mV> <uA>" の表を送信する
+static void COLD_FUNC iv_sweep() {
+  uint8_t hz = mains_hz;
+  start_mains(0);
+
+  // ブザーを止めてタイマRCを借りる
+  uint8_t trcmr = device::TRCMR();
+  uint8_t trccr1 = device::TRCCR1();
+  uint8_t trccr2 = device::TRCCR2();
+  uint8_t trcoer = device::TRCOER();
+  uint16_t gra = device::TRCGRA();
+  device::TRCMR.CTS = false;
+
+  device::TRCCR1 = device::TRCCR1.CKS.b(0) | device::TRCCR1.CCLR.b();  // f1, TRCGRAでクリア
+  device::TRCCR2 = device::TRCCR2.POLB.b() | device::TRCCR2.POLC.b();  // アクティブ High
+  device::TRCMR = device::TRCMR.PWMB.b() | device::TRCMR.PWMC.b() | device::TRCMR.PWM2.b();
+  device::TRCOER = device::TRCOER.EA.b() | device::TRCOER.ED.b();  // B, Cのみ出力
+  device::TRCGRA = IV_PWM_PERIOD - 1;
+  device::TRCGRB = IV_PWM_PERIOD;
+  device::TRCGRC = IV_PWM_PERIOD;
+  device::TRCMR.CTS = true;
+
+  print_str("IV\r\n");
+  iv_sweep_polarity(true);
+  iv_sweep_polarity(false);
+
+  device::TRCMR.CTS = false;
+  device::TRCOER = trcoer;
+  device::TRCCR1 = trccr1;
+  device::TRCCR2 = trccr2;
+  device::TRCGRA = gra;
+  device::TRCGRD = gra / 2;
+  device::TRCMR = trcmr;
+
+  start_mains(hz);
+}
+
+// M<hz>: 電源周期同期モード(M50, M60)。M0で通常の測定に戻る。
+static void COLD_FUNC set_mains(const Command& cmd) {
+  if (! cmd.has_arg || (cmd.arg != 0 && cmd.arg != 50 && cmd.arg != 60)) {
+    print_str("ERR\r\n");
+    return;
+  }
+  start_mains(uint8_t(cmd.arg));
+  print_status();
+}
+
+// O<n>: オーバーサンプリング回数を2^nにする(n=2..6)。引数無しなら現在値を返す。
+static void COLD_FUNC set_oversample(const Command& cmd) {
+  if (cmd.has_arg) {
+    if (cmd.arg < OVERSAMPLE_MIN_LOG2 || OVERSAMPLE_MAX_LOG2 < cmd.arg) {
+      print_str("ERR\r\n");
+      return;
+    }
+    oversample_log2 = uint8_t(cmd.arg);
+  }
+
+  print_str("O ");
+  print_uint16(uint16_t(1) << oversample_log2);
+  uart_putc(' ');
+  print_uint16(effective_bits(oversample_log2));
+  print_str("bit\r\n");
+}
+
+// P<n>: A/D変換プロファイルを切り替える(0:最速, 1:標準, 2:高精度)
+static void COLD_FUNC set_ad_profile(const Command& cmd) {
+  if (! cmd.has_arg || AD_PROFILE_COUNT <= cmd.arg) {
+    print_str("ERR\r\n");
+    return;
+  }
+  apply_ad_profile(uint8_t(cmd.arg));
+  print_status();
+}
+
+#define BENCH_CONVERSIONS (1 << OVERSAMPLE_MAX_LOG2)
+
+// B: 各プロファイルでBENCH_CONVERSIONS回変換し、1回あたりの変換時間[ns]と、
+// 1回の測定(両極性の待ちと変換)にかかる時間[us]を表示する
+static void COLD_FUNC benchmark() {
+  const AdProfile* active = ad_profile;
+  uint8_t hz = mains_hz;
+  start_mains(0);
+
+  for (uint8_t i = 0; i < AD_PROFILE_COUNT; ++i) {
+    apply_ad_profile(i);
+    uint8_t saved_log2 = oversample_log2;
+    oversample_log2 = OVERSAMPLE_MAX_LOG2;
+
+    uint32_t start = now_counts();
+    ad_oversampled();
+    uint32_t counts = now_counts() - start;
+    oversample_log2 = saved_log2;
+    uint32_t conv_ns = counts * TICK_NS_PER_COUNT / BENCH_CONVERSIONS;
+    // acquire_polarity()は待ちの途中の1回と、現在のオーバーサンプリング回数分を変換する
+    uint32_t polarity_us = uint32_t(ad_profile->settle_ms) * 1000 + conv_ns * ((uint16_t(1) << oversample_log2) + 1) / 1000;
+
+    uart_putc(ad_profile->name);
+    uart_putc(' ');
+    print_uint16(conv_ns);
+    print_str("ns ");
+    print_uint32(2 * polarity_us);
+    print_str("us\r\n");
+  }
+
+  apply_ad_profile(uint8_t(active - ad_profiles));
+  start_mains(hz);
+}
+
+#define CAP_DISCHARGE_MS 5
+#define CAP_TIMEOUT_COUNTS (uint32_t(25) * TICK_COUNTS_PER_MS)  // 約75uF
+
+// F: 放電させたコンデンサをプラス側で充電し、63.2%に達するまでの時間から容量を求める
+static void COLD_FUNC measure_capacitance() {
+  uint8_t hz = mains_hz;
+  start_mains(0);
+
+  // 両側をLにしてテスタ棒間を短絡し放電させる
+  clear_output();
+  utils::delay::milli_second(CAP_DISCHARGE_MS);
+
+  uint16_t th = charge_threshold(calibration);
+  bool reached = false;
+  uint32_t start = now_counts();
+  uint32_t counts = 0;
+  set_output(true);
+  while (counts < CAP_TIMEOUT_COUNTS) {
+    if (th <= to_oversample_scale(ad())) {
+      reached = true;
+      break;
+    }
+    counts = now_counts() - start;
+  }
+
+  print_str("F ");
+  if (reached) {
+    print_uint32(to_nanofarad(counts * TICK_NS_PER_COUNT));
+    print_str("nF");
+  } else {
+    print_str("OVER");
+  }
+  print_str("\r\n");
+
+  start_mains(hz);
+}
+
+// メインループの監視
+// 通常はウォッチドッグタイマをリセットモードで動かし、全段階のチェックインが揃う度にリフレッシュする
+// (check_in())。1周期(約131ms)揃わなければハードウェアでリセットされるので、割り込み禁止区間や
+// 割り込み処理の中で止まっても、暴走しても検出できる。どの段階が揃わなかったかは.noinitの
+// health_checkinsに残り、起動時に送信する。
+// スニフモードの間だけは、ストップモードから起きるためにウォッチドッグタイマを周期タイマ(割り込み)にし、
+// その割り込みで各段階の期限を確かめる。期限切れの段階があればブザーを止め、段階を.noinitに
+// 記録してからソフトウェアリセットする。この間は割り込み禁止のまま止まると検出できない。
+
+static Supervisor supervisor;
+static ResetRecord reset_record __attribute__((section(".noinit")));
+
+static void supervisor_reset(uint8_t stage) {
+  io.trcmr.bits.is_count_started = false;
+  trace(TRACE_FAULT);
+  trace_buf.frozen = true;
+  record_reset(reset_record, stage);
+  device::PRCR.PRC1 = true;
+  device::PM0.SRST = true;
   while (1) {
-    set_output(true);
-    clock.busy_wait_ms(10);
-    uint16_t plus_voltage = ad();
+    asm("nop");
+  }
+}
+
+struct WatchdogIntr {
+  static INTR_TASK void task() {
+    IsrScope<device::VECTOR::WATCHDOG> scope;
+    trace(TRACE_WATCHDOG);
+    device::WDTIR.WDTIF = false;
+
+    uint8_t checkins = health_checkins;
+    health_checkins = 0;
+    uint8_t s = supervisor.tick(checkins);
+    if (s != STAGE_NONE)
+      supervisor_reset(s);
+    trace(TRACE_WATCHDOG | TRACE_END);
+  }
+};
+INTR_BIND(WATCHDOG, WatchdogIntr)
+
+// アンダフローでリセットする。リフレッシュしてから切り替え、1周期の猶予を作る
+static void watchdog_reset_mode() {
+  watchdog_refresh();
+  device::WDTIR = 0;
+  device::RISR.RIS = true;
+  health_checkins = 0;
+  watchdog_periodic = false;
+}
+
+// アンダフローで割り込む(周期タイマ)。スニフモードの間だけ使う
+static void watchdog_periodic_mode() {
+  watchdog_periodic = true;
+  health_checkins = 0;
+  supervisor = Supervisor();
+  device::RISR.RIS = false;
+  device::WDTIR = device::WDTIR.WDTIE.b();
+  watchdog_refresh();
+}
+
+// カウントソース保護モードにすると、ストップモード中もfOCO-Sで数え続ける。
+static void COLD_FUNC init_watchdog_timer() {
+  device::CSPR.CSPRO = false;  // 0を書いてから1を書く
+  device::CSPR.CSPRO = true;
+  health_checkins = 0;
+  device::WDTIR = 0;
+  device::RISR.RIS = true;     // アンダフローでリセットする
+  device::WDTS = 0;            // 書き込みでカウント開始
+}
+
+// 起動時にリセット要因を "RESET <要因> <監視によるリセット回数>" で送信する。
+// stage は監視によるリセットで止まっていた段階
+static void COLD_FUNC report_reset(uint8_t stage) {
+  bool warm = device::RSTFR.CWR();
+  device::RSTFR.CWR = true;
+
+  print_str("RESET ");
+  if (stage != STAGE_NONE) {
+    print_str("STALL ");
+    print_str(stage_name(stage));
+  } else if (! warm) {
+    print_str("POWER");
+  } else if (device::RSTFR.WDR()) {
+    print_str("WDT");
+  } else if (device::RSTFR.SWR()) {
+    print_str("SW");
+  } else {
+    print_str("HW");
+  }
+  uart_putc(' ');
+  print_uint16(reset_record.count);
+  print_str("\r\n");
+}
+
+// スニフモード
+// 接触もコマンドも無い状態が続いたら、周期タイマ割り込みまでストップモードで眠り、
+// 起きたら両極性を1回ずつ変換するだけの短い測定をする。接触を見つけたら連続測定に戻る。
+// ストップモード中はUARTも止まるので、その間に届いた文字は失われる。
+
+#define SNIFF_IDLE_MILLIS 5000
+#define SNIFF_SETTLE_US 500
 
-    set_output(false);
-    clock.busy_wait_ms(10);
-    uint16_t minus_voltage = ad();
-//    print(plus_voltage, minus_voltage);
+static bool sniff_enabled = true;
+static bool sniffing;
+static uint32_t sniff_woke_counts;
+static uint32_t sniff_awake_us;      // 直前の周期で起きていた時間
+static uint32_t sniff_max_awake_us;
 
-    auto_power_off_timer_millis -= 20;
-    if (is_on(plus_voltage) || is_on(minus_voltage))
-      auto_power_off_timer_millis = AUTO_POWER_OFF_MILLIS;
+static bool sniff_allowed() {
+  return sniff_enabled && ! mains_hz && ! resistance_streaming && ! diode_reporting && ! calibration_request;
+}
+
+static void enter_sniff() {
+  set_leds(false, false);
+  io.trcmr.bits.is_count_started = false;
+  watchdog_periodic_mode();
+  sniffing = true;
+  sniff_woke_counts = now_counts();
+}
+
+// 送信を終えてから、次の周期タイマ割り込みまでストップモードで眠る。
+// 全クロックが止まってタイマRJも止まるので、眠っていた時間を経過時間に足す。
+static void stop_until_wakeup() {
+  while (send_buf.length() || ! io.u0c1.bits.is_tx_buf_empty) {
+    asm("nop");
+  }
+
+  sniff_awake_us = (now_counts() - sniff_woke_counts) * TICK_NS_PER_COUNT / 1000;
+  if (sniff_max_awake_us < sniff_awake_us)
+    sniff_max_awake_us = sniff_awake_us;
+  uint16_t asleep = sniff_asleep_ms(sniff_awake_us);
+  trace(TRACE_SNIFF_STOP);
+
+  device::PRCR.PRC0 = true;
+  device::CKSTPR.STPM = true;  // ここで止まり、割り込みで再開する
+  asm("nop");
+  asm("nop");
+  asm("nop");
+  asm("nop");
+  device::PRCR.PRC0 = false;
+
+  {
+    Critical cs;
+    tick_millis = tick_millis + asleep;
+  }
+  sniff_woke_counts = now_counts();
+  trace(TRACE_SNIFF_WAKE);
+}
+
+// 両極性を1回ずつ変換する。接触していればtrue
+static bool sniff_burst() {
+  set_output(true);
+  utils::delay::micro_second(SNIFF_SETTLE_US);
+  uint16_t pv = to_oversample_scale(ad());
+  set_output(false);
+  utils::delay::micro_second(SNIFF_SETTLE_US);
+  uint16_t mv = to_oversample_scale(ad());
+  return is_on(pv) || is_on(mv);
+}
+
+// 1周期眠ってから測定する。スニフモードを続けるならtrue
+static bool sniff() {
+  stop_until_wakeup();
+  bool contact = sniff_burst();
+  check_in(stage_bit(Stage::ACQUIRE) | stage_bit(Stage::CLASSIFY) | stage_bit(Stage::ACTUATE));
+  return ! contact && ! recv_buf.length();
+}
+
+// Z1: スニフモードを有効にする。Z0で常に連続測定。
+// "Z 1 <起きていた時間> <平均電流> <削減率> <最悪の検出遅れ>" を表示する(1周期で一番長く起きていた時の値)。
+static void COLD_FUNC set_sniff(const Command& cmd) {
+  if (cmd.has_arg)
+    sniff_enabled = cmd.arg != 0;
+
+  uint16_t ua = sniff_average_microamp(sniff_max_awake_us);
+  print_str("Z ");
+  uart_putc(sniff_enabled ? '1' : '0');
+  uart_putc(' ');
+  print_uint32(sniff_max_awake_us);
+  print_str("us ");
+  print_uint16(ua);
+  print_str("uA ");
+  print_uint16(sniff_reduction_percent(ua));
+  print_str("% ");
+  print_uint16(sniff_worst_delay_ms(sniff_max_awake_us));
+  print_str("ms\r\n");
+}
+
+struct Reading {
+  uint16_t plus;
+  uint16_t minus;
+  bool charging;  // 測定中に値が上昇し続けていた(大きなコンデンサを充電中)
+};
+
+// 極性を切り替え、待ち時間の途中と最後で測定する
+static uint16_t HOT_FUNC acquire_polarity(bool plus, bool& charging) {
+  uint8_t half = ad_profile->settle_ms / 2;
+  set_output(plus);
+  utils::delay::milli_second(half);
+  uint16_t early = to_oversample_scale(ad());
+  utils::delay::milli_second(ad_profile->settle_ms - half);
+  uint16_t v = ad_oversampled();
+
+  if (is_charging(early, v))
+    charging = true;
+  return v;
+}
+
+// 1回分の測定。結果がまだ無ければfalse
+static bool HOT_FUNC acquire(Reading& r) {
+  r.charging = false;
+  if (mains_hz)
+    return mains_fetch(r.plus, r.minus);
+
+  r.plus = acquire_polarity(true, r.charging);
+  r.minus = acquire_polarity(false, r.charging);
+  return true;
+}
 
-    if (auto_power_off_timer_millis < 0)
+static Mode current_mode() {
+  if (sniffing)
+    return Mode::SNIFF;
+  return mains_hz ? Mode::MAINS : Mode::CONTINUOUS;
+}
+
+static void print_counter(const char* name, uint32_t v) {
+  print_str(name);
+  uart_putc(' ');
+  print_uint32(v);
+  print_str("\r\n");
+}
+
+// T: 統計を "<名前> <値>" の行で送信する(時間はLOOPMAXがus、各モードがms)。T0で送信後に0に戻す。
+static void COLD_FUNC print_stats(const Command& cmd) {
+  Stats s;
+  {
+    Critical cs;
+    s = stats;
+  }
+
+  print_counter("LOOP", s.loops);
+  print_counter("CONV", s.conversions);
+  print_counter("RETUNE", s.retunes);
+  print_counter("TRANS", s.transitions);
+  print_counter("TX", s.tx_bytes);
+  print_counter("RX", s.rx_bytes);
+  print_counter("OVR", s.overruns);
+  print_counter("FRM", s.framing_errors);
+  print_counter("LOOPMAX", tick_counts_to_us(s.max_loop_counts));
+#ifdef INSTRUMENT
+  print_counter("INTROFF", tick_counts_to_us(s.max_intr_off_counts));
+#endif
+  for (uint8_t m = 0; m < MODE_COUNT; ++m)
+    print_counter(mode_name(Mode(m)), s.mode_ms[m]);
+
+  if (cmd.has_arg && cmd.arg == 0) {
+    Critical cs;
+    stats = Stats();
+  }
+}
+
+// I: 割り込み毎に "I <名前> <優先レベル> <回数> <最大応答時間[ns]> <最大実行時間[ns]>" を送信する。
+// 応答時間を測らない割り込みは "-"。I0で送信後に0に戻す。
+static void COLD_FUNC print_isr_timings(const Command& cmd) {
+  for (uint8_t i = 0; i < priority::plan.size(); ++i) {
+    IsrTiming t;
+    {
+      Critical cs;
+      t = isr_timings[i];
+    }
+
+    const device::intr_level_t& l = priority::plan.levels[i];
+    print_str("I ");
+    print_str(l.name);
+    uart_putc(' ');
+    print_uint16(l.level);
+    uart_putc(' ');
+    print_uint32(t.count);
+    uart_putc(' ');
+    if (t.has_latency)
+      print_uint32(uint32_t(t.max_latency) * TICK_NS_PER_COUNT);
+    else
+      uart_putc('-');
+    uart_putc(' ');
+    print_uint32(uint32_t(t.max_exec) * TICK_NS_PER_COUNT);
+    print_str("\r\n");
+  }
+
+  if (cmd.has_arg && cmd.arg == 0) {
+    Critical cs;
+    for (uint8_t i = 0; i < priority::plan.size(); ++i)
+      isr_timings[i] = IsrTiming();
+  }
+}
+
+// E: トレースを凍結して "E <件数>" に続けて古い順に "<ID> <タイムスタンプ>" (16進)を送信する。
+// E0: 凍結, E1: 消去して記録を再開
+static void COLD_FUNC trace_command(const Command& cmd) {
+  if (cmd.has_arg) {
+    if (cmd.arg == 0) {
+      trace_buf.frozen = true;
+    } else {
+      Critical cs;
+      trace_buf.clear();
+    }
+    return;
+  }
+
+  trace_buf.frozen = true;
+  print_str("E ");
+  print_uint16(trace_buf.count);
+  print_str("\r\n");
+  for (uint8_t n = 0; n < trace_buf.count; ++n) {
+    keep_alive();
+    uint8_t i = trace_buf.index(n);
+    print_hex(trace_buf.ids[i], 2);
+    uart_putc(' ');
+    print_hex(trace_buf.stamps[i], 4);
+    print_str("\r\n");
+  }
+  print_str("E END\r\n");
+}
+
+// U: RAM使用量を送信する。スタックは "<最大使用量>/<大きさ>"
+static void COLD_FUNC print_ram_usage() {
+  ram_usage_t u;
+  get_ram_usage(&u);
+
+  print_str("U DATA ");
+  print_uint16(u.data);
+  print_str(" BSS ");
+  print_uint16(u.bss);
+  print_str(" NOINIT ");
+  print_uint16(u.noinit);
+  print_str("\r\nU STACK ");
+  print_uint16(u.ustack - u.ustack_unused);
+  uart_putc('/');
+  print_uint16(u.ustack);
+  print_str(" ISTACK ");
+  print_uint16(u.istack - u.istack_unused);
+  uart_putc('/');
+  print_uint16(u.istack);
+  // 静的コンストラクタの数と、クロック切り替えから最初の測定が終わるまで[us]
+  print_str("\r\nU INIT ");
+  print_uint16(get_init_array_count());
+  print_str("\r\nU BOOT");
+  for (uint8_t i = 0; i < BOOT_STAGE_COUNT; ++i) {
+    uart_putc(' ');
+    print_str(boot_stage_name(BootStage(i)));
+    uart_putc(' ');
+    print_uint32(boot_log.us[i]);
+  }
+  print_str("\r\n");
+}
+
+// Q1: プロファイルを消去してサンプリングを始める。Q0で止める。
+// Q: "Q <サンプル数> <範囲外>" に続けて、0でない区間を "<先頭アドレス(16進)> <回数>" で送信する
+static void COLD_FUNC profile_command(const Command& cmd) {
+  if (cmd.has_arg) {
+    {
+      Critical cs;
+      if (cmd.arg)
+        profile.clear();
+      profiling = cmd.arg != 0;
+    }
+    start_timer_rb();
+    return;
+  }
+
+  bool active = profiling;
+  profiling = false;
+  print_str("Q ");
+  print_uint16(profile.samples);
+  uart_putc(' ');
+  print_uint16(profile.outside);
+  print_str("\r\n");
+  for (uint8_t i = 0; i < PROFILE_BUCKETS; ++i) {
+    if (! profile.buckets[i])
+      continue;
+    keep_alive();
+    print_hex(ProfileHistogram::bucket_address(i), 4);
+    uart_putc(' ');
+    print_uint16(profile.buckets[i]);
+    print_str("\r\n");
+  }
+  print_str("Q END\r\n");
+  profiling = active;
+}
+
+static CommandReader command_reader;
+
+// 高速モードの速度表。F_CLKで誤差無く作れる速度だけ使える(20MHzでは全て)。
+struct UartRate {
+  uint16_t kbaud;
+  UartSetting setting;
+  bool exact;
+};
+
+constexpr UartRate uart_rate(uint16_t kbaud) {
+  return UartRate { kbaud, uart_setting(F_CLK, uint32_t(kbaud) * 1000), uart_exact(F_CLK, uint32_t(kbaud) * 1000) };
+}
+
+#define UART_RATE_COUNT 3
+static constexpr UartRate uart_rates[UART_RATE_COUNT] = {
+  uart_rate(250),   // 20MHzでは f1, U0BRG = 4
+  uart_rate(625),   // 20MHzでは f1, U0BRG = 1
+  uart_rate(1250),  // 20MHzでは f1, U0BRG = 0
+};
+
+static UartLink uart_link;
+static uint16_t uart_fallbacks;
+
+// 速度表の位置(0は既定の速度)のビットレート
+static uint32_t uart_link_baud(uint8_t rate) {
+  return rate ? uint32_t(uart_rates[rate - 1].kbaud) * 1000 : UART_BAUD;
+}
+
+// 送信し終えてから速度を変える。切り替え中に届いた文字は捨てる。
+static void COLD_FUNC set_uart_rate(uint8_t rate) {
+  resume_tx();
+  while (send_buf.length()) {
+    asm("nop");
+  }
+  while (! device::UART0::UC0.TXEPT()) {
+    asm("nop");
+  }
+
+  const UartSetting& u = rate ? uart_rates[rate - 1].setting : uart_default;
+  Critical cs;
+  io.u0c1.set(u0c1_t());  // 送受信を止めてから変える
+  io.u0c0.bits.clk_div = U0C0_CLK(u.clk);
+  io.u0brg = u.brg;
+  io.u0c1.set(u0c1_t().with_tx_enabled(true).with_rx_enabled(true));
+  recv_buf.clear();
+  command_reader = CommandReader();
+}
+
+static void print_uart_link(const char* result) {
+  print_str("H ");
+  print_uint32(uart_link_baud(uart_link.rate()));
+  if (result) {
+    uart_putc(' ');
+    print_str(result);
+  }
+  print_str("\r\n");
+}
+
+// H<kbaud>: 高速モード。H250 / H625 / H1250 で "H <bps>" を送信してから切り替える。
+// 相手も切り替えて同じコマンドを送ると "H <bps> OK" で確定する。H0で既定の速度に戻す。
+// 1秒以内に確定しない時と、1秒に4回以上受信エラーが起きた時は既定の速度に戻して "H <bps> FALLBACK" を送信する。
+// 引数無しで "H <bps> <状態> <受信エラー数> <戻した回数>" を送信する。
+static void COLD_FUNC uart_link_command(const Command& cmd) {
+  if (! cmd.has_arg) {
+    print_str("H ");
+    print_uint32(uart_link_baud(uart_link.rate()));
+    uart_putc(' ');
+    print_uint16(uint16_t(uart_link.state()));
+    uart_putc(' ');
+    print_uint16(uart_errors);
+    uart_putc(' ');
+    print_uint16(uart_fallbacks);
+    print_str("\r\n");
+    return;
+  }
+
+  uint8_t rate = 0;
+  if (cmd.arg) {
+    for (uint8_t i = 0; i < UART_RATE_COUNT; ++i) {
+      if (uart_rates[i].kbaud == cmd.arg && uart_rates[i].exact)
+        rate = i + 1;
+    }
+    if (! rate) {
+      print_str("ERR\r\n");
+      return;
+    }
+  }
+
+  if (uart_link.confirm(rate, uart_errors, now())) {
+    print_uart_link("OK");
+    return;
+  }
+
+  print_str("H ");
+  print_uint32(uart_link_baud(rate));
+  print_str("\r\n");
+  set_uart_rate(rate);
+  uart_link.request(rate, uart_errors, now());
+}
+
+// 高速モードで確認が来ないか受信エラーが多ければ、既定の速度に戻す
+static void check_uart_link() {
+  if (! uart_link.check(uart_errors, now()))
+    return;
+
+  ++uart_fallbacks;
+  set_uart_rate(0);
+  print_uart_link("FALLBACK");
+}
+
+static void COLD_FUNC run_command(const Command& cmd) {
+  switch (cmd.name) {
+    case 'O':
+    set_oversample(cmd);
+    break;
+
+    case 'P':
+    set_ad_profile(cmd);
+    break;
+
+    case 'B':
+    benchmark();
+    break;
+
+    case 'S':
+    print_status();
+    break;
+
+    case 'M':
+    set_mains(cmd);
+    break;
+
+    case 'C':
+    set_calibration(cmd);
+    break;
+
+    case 'R':
+    set_resistance_streaming(cmd);
+    break;
+
+    case 'D':
+    set_diode_reporting(cmd);
+    break;
+
+    case 'V':
+    iv_sweep();
+    break;
+
+    case 'F':
+    measure_capacitance();
+    break;
+
+    case 'Z':
+    set_sniff(cmd);
+    break;
+
+    case 'T':
+    print_stats(cmd);
+    break;
+
+    case 'I':
+    print_isr_timings(cmd);
+    break;
+
+    case 'E':
+    trace_command(cmd);
+    break;
+
+    case 'U':
+    print_ram_usage();
+    break;
+
+    case 'Q':
+    profile_command(cmd);
+    break;
+
+    case 'H':
+    uart_link_command(cmd);
+    break;
+
+    default:
+    print_str("ERR\r\n");
+    break;
+  }
+}
+
+// 何か受信したらtrue
+static bool poll_command() {
+  check_in(stage_bit(Stage::TELEMETRY));
+  check_uart_link();
+  bool received = recv_buf.length();
+  Command cmd;
+  while (recv_buf.length()) {
+    if (! command_reader.feed(recv_buf.get(), cmd))
+      continue;
+
+    trace(TRACE_COMMAND);
+    run_command(cmd);
+    trace(TRACE_COMMAND | TRACE_END);
+  }
+  return received;
+}
+
+int HOT_FUNC main(int argc, char *argv[]) {
+  // 割り込みが記録を始める前に、.noinitのトレースを初期化する
+  uint8_t stalled = take_reset_stage(reset_record);
+  if (stalled == STAGE_NONE && device::RSTFR.CWR() && device::RSTFR.WDR()) {
+    // ウォッチドッグのリセット: チェックインが揃わなかった段階
+    stalled = missing_stage(health_checkins);
+    if (stalled != STAGE_NONE)
+      record_reset(reset_record, STAGE_NONE);
+  }
+  if (stalled == STAGE_NONE) {
+    trace_buf.clear();
+  } else {
+    trace_buf.sanitize();  // リセット前のトレースを凍結したまま残す
+    trace_buf.frozen = true;
+  }
+
+  boot_stage(BootStage::MAIN);
+  load_saved_calibration();
+  update_on_threshold();
+  init_measure();
+  set_leds(true, true);
+  boot_stage(BootStage::MEASURE);
+
+  // ボタンを押してからの反応を速くするため、最初の測定と表示をUARTの設定より先に行う
+  {
+    Reading r;
+    if (acquire(r) && ! r.charging) {
+      disp(r.plus, r.minus);
+      buzz(min(r.plus, r.minus));
+    }
+    boot_stage(BootStage::RESULT);
+  }
+
+  init_uart();
+  boot_stage(BootStage::UART);
+  init_watchdog_timer();
+  report_reset(stalled);
+  boot_stage(BootStage::READY);
+
+  uint32_t last_active_millis = now();
+  uint32_t last_command_millis = last_active_millis;
+  uint32_t loop_counts = now_counts();
+  uint32_t loop_millis = now();
+  Mode mode = current_mode();
+  uint8_t contact = 0;
+
+  while (1) {
+    trace(TRACE_LOOP);
+    uint32_t c = now_counts();
+    uint32_t ms = now();
+    stats.loop_done(c - loop_counts, ms - loop_millis, mode);
+    loop_counts = c;
+    loop_millis = ms;
+    if (current_mode() != mode) {
+      mode = current_mode();
+      ++stats.transitions;
+    }
+
+    if (poll_command())
+      last_command_millis = now();
+
+    if (sniffing) {
+      if (sniff()) {
+        uint32_t t = now();
+        if (AUTO_POWER_OFF_MILLIS < t - last_active_millis)
+          power_off();
+        check_supply(t);
+        continue;
+      }
+      sniffing = false;
+      watchdog_reset_mode();
+      last_active_millis = now();
+    }
+
+    Reading r;
+    trace(TRACE_ACQUIRE);
+    bool acquired = acquire(r);
+    trace(TRACE_ACQUIRE | TRACE_END);
+    if (! acquired)
+      continue;
+    check_in(stage_bit(Stage::ACQUIRE));
+
+//    print(r.plus, r.minus);
+
+    uint16_t v = min(r.plus, r.minus);
+    if (calibration_request)
+      capture_calibration(v);
+    if (resistance_streaming)
+      print_resistance(v);
+    if (diode_reporting)
+      report_diode(r.plus, r.minus);
+
+    uint32_t t = now();
+    bool active = r.charging || is_on(r.plus) || is_on(r.minus);
+    if (active)
+      last_active_millis = t;
+    check_in(stage_bit(Stage::CLASSIFY));
+
+    uint8_t now_contact = (is_on(r.plus) ? 1 : 0) | (is_on(r.minus) ? 2 : 0);
+    if (now_contact != contact) {
+      contact = now_contact;
+      ++stats.transitions;
+      trace(TRACE_CONTACT);
+    }
+
+    if (AUTO_POWER_OFF_MILLIS < t - last_active_millis)
       power_off();
 
-    disp(plus_voltage, minus_voltage);
-    buzz(min(plus_voltage, minus_voltage));
+    check_supply(t);
+    if (! active && sniff_allowed()
+        && SNIFF_IDLE_MILLIS < t - last_active_millis
+        && SNIFF_IDLE_MILLIS < t - last_command_millis) {
+      enter_sniff();
+      continue;
+    }
+
+    check_in(stage_bit(Stage::ACTUATE));
+
+    if (supply_state_now != SupplyState::OK && ! active) {
+      // 電池残量低下: 何も接触していない間はテスタ棒のLEDを点滅させる
+      bool blink = (t / 500) & 1;
+      set_leds(blink, blink);
+      buzz(UINT16_MAX);
+      continue;
+    }
+
+    if (r.charging) {
+      // 充電中のコンデンサは短絡と区別して鳴らさない
+      disp(UINT16_MAX, UINT16_MAX);
+      buzz(UINT16_MAX);
+      continue;
+    }
+
+    disp(r.plus, r.minus);
+    buzz(v);
   }
 }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include "oversample.h"
+#include "clock_config.h"
+
+#define MAINS_SAMPLES_LOG2 5
+#define MAINS_SAMPLES (1 << MAINS_SAMPLES_LOG2)  // 1周期あたりのサンプル数
+#define MAINS_SETTLE_SAMPLES 8  // 極性切り替え後に捨てるサンプル数
+
+// タイマRBの周期 = 電源1周期 / MAINS_SAMPLES
+// 50Hz: 625us (20ms / 32)
+// 60Hz: 520.8us (16.667ms / 32)
+#define MAINS_MAX_ERROR_PPM 1000  // 積分区間が1周期からずれると電源ノイズが残る
+
+constexpr uint32_t mains_counts(uint8_t hz) {
+  return (F_CLK + hz * MAINS_SAMPLES / 2) / (hz * MAINS_SAMPLES);
+}
+
+static constexpr TimerRbSetting MAINS_TIMING_50 = timer_rb_setting(mains_counts(50));
+static constexpr TimerRbSetting MAINS_TIMING_60 = timer_rb_setting(mains_counts(60));
+
+static_assert(MAINS_TIMING_50.div && timer_rb_error_ppm(mains_counts(50), MAINS_TIMING_50) <= MAINS_MAX_ERROR_PPM,
+              "timer RB cannot divide the 50Hz period at F_CLK");
+static_assert(MAINS_TIMING_60.div && timer_rb_error_ppm(mains_counts(60), MAINS_TIMING_60) <= MAINS_MAX_ERROR_PPM,
+              "timer RB cannot divide the 60Hz period at F_CLK");
+
+inline TimerRbSetting mains_timing(uint8_t hz) {
+  return hz == 60 ? MAINS_TIMING_60 : MAINS_TIMING_50;
+}
+
+// 電源周期に同期した積分。
+// 極性毎に、切り替え後MAINS_SETTLE_SAMPLES回を捨ててから、ちょうど1周期分のサンプルを積算する。
+// 1周期で積分するので電源周波数とその高調波の成分は打ち消される。
+class SyncIntegrator {
+  uint8_t tick_ = 0;
+  uint16_t sum_ = 0;
+  bool plus_ = true;
+  uint16_t plus_result_ = 0;
+
+public:
+  void reset() {
+    tick_ = 0;
+    sum_ = 0;
+    plus_ = true;
+  }
+
+  // 次のサンプルを取る時の極性
+  bool is_plus() const { return plus_; }
+
+  // 1サンプル渡す。+/-両方の積分が揃ったらtrueを返し、結果をOVERSAMPLE_BITSのスケールで返す。
+  bool feed(uint16_t v, uint16_t& plus, uint16_t& minus) {
+    if (MAINS_SETTLE_SAMPLES <= tick_)
+      sum_ += v;
+
+    if (++tick_ < MAINS_SETTLE_SAMPLES + MAINS_SAMPLES)
+      return false;
+
+    uint16_t r = decimate(sum_, MAINS_SAMPLES_LOG2);
+    tick_ = 0;
+    sum_ = 0;
+    plus_ = ! plus_;
+
+    if (! plus_) {
+      plus_result_ = r;
+      return false;
+    }
+
+    plus = plus_result_;
+    minus = r;
+    return true;
+  }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#define AD_BITS 10
+#define OVERSAMPLE_BITS 13  // 間引き後の出力ビット数 (64回で+3bit)
+#define OVERSAMPLE_MIN_LOG2 2  // 4回
+#define OVERSAMPLE_MAX_LOG2 6  // 64回
+
+// 10bit値をOVERSAMPLE_BITSのスケールに変換する
+constexpr uint16_t to_oversample_scale(uint16_t v) {
+  return v << (OVERSAMPLE_BITS - AD_BITS);
+}
+
+// 2^log2_n回分の変換結果の合計(integrate-and-dump)を、
+// 回数に関係なくOVERSAMPLE_BITSビットのスケールに揃える(四捨五入)。
+inline uint16_t decimate(uint16_t sum, uint8_t log2_n) {
+  const uint8_t extra = OVERSAMPLE_BITS - AD_BITS;
+  if (log2_n < extra) return sum << (extra - log2_n);
+
+  uint8_t shift = log2_n - extra;
+  if (shift == 0) return sum;
+  // intが16bitなので sum + 0.5LSB は桁あふれし得る。切り捨てた最上位ビットで丸める。
+  return (sum >> shift) + ((sum >> (shift - 1)) & 1);
+}
+
+// 4回で1bit分、分解能が増える
+inline uint8_t effective_bits(uint8_t log2_n) {
+  uint8_t bits = AD_BITS + log2_n / 2;
+  return bits < OVERSAMPLE_BITS ? bits : OVERSAMPLE_BITS;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common/intr_level.hpp"
+
+// 割り込み優先レベルの表
+// boot_early() で device::intr_plan_setup<priority::plan>() が全てのILVLレジスタに書き込む。
+// 各周辺の初期化では優先レベルを書かないこと。
+//
+// 測定(タイマRB)は通信(UART)より高くし、UARTの割り込みは入口で割り込みを許可するので(INTR_BIND_NESTED)、
+// 通信量が増えても測定は待たされない。時間の基準(タイマRJ)は最も高くし、多重割り込みを許した処理の中でも時刻が進むようにする。
+
+enum class IntrGroup : uint8_t {
+  TIMEBASE,   // 1ms クロック
+  MEASURE,    // 電源周期同期のサンプリングとプロファイラ
+  SUPERVISE,  // 監視
+  TELEMETRY,  // 通信
+};
+
+namespace priority {
+
+typedef device::VECTOR V;
+
+static constexpr auto plan = device::make_intr_plan(
+  device::intr_level_t { V::TIMER_RJ, 3, uint8_t(IntrGroup::TIMEBASE), "TIMER_RJ" },
+  device::intr_level_t { V::TIMER_RB, 2, uint8_t(IntrGroup::MEASURE), "TIMER_RB" },
+  device::intr_level_t { V::WATCHDOG, 1, uint8_t(IntrGroup::SUPERVISE), "WATCHDOG" },
+  device::intr_level_t { V::UART0_TX, 1, uint8_t(IntrGroup::TELEMETRY), "UART_TX" },
+  device::intr_level_t { V::UART0_RX, 1, uint8_t(IntrGroup::TELEMETRY), "UART_RX" }
+);
+
+static_assert(plan.min_level(uint8_t(IntrGroup::MEASURE)) > plan.max_level(uint8_t(IntrGroup::TELEMETRY)),
+              "measurement must preempt telemetry");
+static_assert(plan.min_level(uint8_t(IntrGroup::TIMEBASE)) > plan.max_level(uint8_t(IntrGroup::MEASURE)),
+              "timebase must preempt measurement");
+static_assert(plan.min_level(uint8_t(IntrGroup::TIMEBASE)) > plan.max_level(uint8_t(IntrGroup::SUPERVISE)),
+              "timebase must preempt supervision");
+
+}
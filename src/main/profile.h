@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include "clock_config.h"
+
+// PCサンプリングによるプロファイラ
+// タイマRBの割り込み毎に割り込まれたPCを受け取り、アドレス範囲毎の回数を数える。
+// tools/profile2sym.py でマップファイル(またはELF)のシンボルに対応付けられる。
+
+#define PROFILE_BASE 0x8000UL      // ROMの先頭
+#define PROFILE_BUCKET_LOG2 9      // 512バイト毎
+#define PROFILE_BUCKETS 64         // 0x8000〜0xFFFF
+
+// 電源周期同期モードでない時のサンプリング周期。
+// タイマRJの1msと同期しないよう、1.003ms (約997Hz)にする。
+#define PROFILE_PERIOD_US 1003
+
+static constexpr TimerRbSetting PROFILE_TIMING = timer_rb_setting(clock_counts_us(PROFILE_PERIOD_US));
+static_assert(PROFILE_TIMING.div && PROFILE_TIMING.counts() % (F_CLK / 1000) != 0,
+              "profiler period must not be a multiple of the 1ms tick");
+
+struct ProfileHistogram {
+  uint16_t buckets[PROFILE_BUCKETS];
+  uint16_t outside;  // 範囲外(.exttext等)
+  uint16_t samples;
+
+  void clear() {
+    for (uint8_t i = 0; i < PROFILE_BUCKETS; ++i)
+      buckets[i] = 0;
+    outside = 0;
+    samples = 0;
+  }
+
+  // samplesが上限に達したら記録をやめる(各区間の回数もあふれない)
+  void record(uint32_t pc) {
+    if (samples == UINT16_MAX)
+      return;
+    ++samples;
+
+    uint32_t offset = pc - PROFILE_BASE;
+    if (pc < PROFILE_BASE || (uint32_t(PROFILE_BUCKETS) << PROFILE_BUCKET_LOG2) <= offset) {
+      ++outside;
+      return;
+    }
+    ++buckets[offset >> PROFILE_BUCKET_LOG2];
+  }
+
+  static uint32_t bucket_address(uint8_t i) {
+    return PROFILE_BASE + (uint32_t(i) << PROFILE_BUCKET_LOG2);
+  }
+};
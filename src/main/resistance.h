@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include "oversample.h"
+
+#define SENSE_OHMS 330  // R6
+#define VCC_MILLIVOLT 5000  // DC/DC出力の公称値
+#define RESISTANCE_OPEN UINT32_MAX
+
+// 個体毎の校正値(OVERSAMPLE_BITSのスケールのA/D値)
+struct Calibration {
+  uint16_t open;     // テスタ棒を開放した時。DC/DC出力とA/D基準の比
+  uint16_t shorted;  // テスタ棒を短絡した時。ブリッジのオン抵抗分
+  uint16_t vcc_mv;   // 短絡時の値を取り込んだ時のVcc[mV]。オン抵抗はゲート電圧(Vcc)で変わる
+};
+
+#define CALIBRATION_DEFAULT Calibration { to_oversample_scale(1023), 0, VCC_MILLIVOLT }
+
+// 測定値をmΩに変換する。
+// 開放時の電圧をVo、短絡時をVs、ブリッジのオン抵抗をR0とすると
+//   v = Vo * (R + R0) / (Rs + R + R0),  Vs = Vo * R0 / (Rs + R0)
+// より
+//   R = Rs * Vo * (v - Vs) / ((Vo - v) * (Vo - Vs))
+// 32bitに収まるよう割り算を2回に分けている。
+inline uint32_t to_milliohm(uint16_t v, const Calibration& cal) {
+  if (v <= cal.shorted)
+    return 0;
+  if (cal.open <= v || cal.open <= cal.shorted)
+    return RESISTANCE_OPEN;
+
+  uint16_t vo = cal.open;
+  uint16_t dv = vo - v;
+  uint32_t b = uint32_t(SENSE_OHMS) * 1000 * (v - cal.shorted) / (vo - cal.shorted);
+
+  uint32_t q = b / dv;
+  if (UINT32_MAX / vo < q)
+    return RESISTANCE_OPEN;
+
+  return q * vo + (b % dv) * vo / dv;
+}
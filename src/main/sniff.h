@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// スニフモード
+// 何も接触していない間はストップモードで眠り、ウォッチドッグの周期タイマ割り込みで起きて
+// 短時間だけ測定する。
+
+// 周期タイマはカウントソース保護モードで低速オンチップオシレータ(fOCO-S)を数える。
+// OFS2.WDTUFS = 11b (3FFFh) なので 16384 / 125kHz。
+#define SNIFF_PERIOD_MS 131
+#define SNIFF_PERIOD_MAX_MS 164  // fOCO-Sの下限(100kHz)の時
+
+// 消費電流の見積もりに使うマイコン単体の値(データシートの標準値程度)
+#define SNIFF_RUN_MICROAMP 5000  // 高速オンチップオシレータ20MHzで動作中
+#define SNIFF_STOP_MICROAMP 5    // ストップモード, fOCO-Sのみ動作
+
+// 1周期あたり起きていた時間[us]から平均電流[uA]を見積もる
+inline uint16_t sniff_average_microamp(uint32_t awake_us) {
+  const uint32_t period_us = uint32_t(SNIFF_PERIOD_MS) * 1000;
+  if (period_us <= awake_us)
+    return SNIFF_RUN_MICROAMP;
+
+  return (uint32_t(SNIFF_RUN_MICROAMP) * awake_us
+          + uint32_t(SNIFF_STOP_MICROAMP) * (period_us - awake_us)) / period_us;
+}
+
+// 連続測定に対する削減率[%]
+inline uint8_t sniff_reduction_percent(uint16_t average_microamp) {
+  if (SNIFF_RUN_MICROAMP <= average_microamp)
+    return 0;
+  return uint32_t(SNIFF_RUN_MICROAMP - average_microamp) * 100 / SNIFF_RUN_MICROAMP;
+}
+
+// 接触してから検出するまでの最悪値[ms]。
+// 測定の直後に接触すると、次の周期の測定が終わるまで気付かない。
+inline uint16_t sniff_worst_delay_ms(uint32_t awake_us) {
+  return SNIFF_PERIOD_MAX_MS + (awake_us + 999) / 1000;
+}
+
+// ストップモード中に止まっていたタイマRJの代わりに、眠っていた時間[ms]を求める。
+// 起きるのは常に周期タイマのアンダフローなので、周期から起きていた時間を引けば良い。
+inline uint16_t sniff_asleep_ms(uint32_t awake_us) {
+  uint32_t awake_ms = awake_us / 1000;
+  return awake_ms < SNIFF_PERIOD_MS ? SNIFF_PERIOD_MS - awake_ms : 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// 動作統計
+// ホットパスでは該当カウンタを1つ増やすだけにし、集計は表示する時に行う。
+
+enum class Mode : uint8_t {
+  CONTINUOUS,  // 通常の連続測定
+  MAINS,       // 電源周期同期モード
+  SNIFF,       // スニフモード
+};
+
+#define MODE_COUNT 3
+
+struct Stats {
+  uint32_t loops;
+  uint32_t conversions;     // A/D変換回数
+  uint16_t retunes;         // ブザーの周波数変更
+  uint16_t transitions;     // 導通状態・動作モードの変化
+  uint32_t tx_bytes;
+  uint32_t rx_bytes;
+  uint16_t overruns;        // オーバーランエラーと受信バッファあふれ
+  uint16_t framing_errors;  // フレーミング・パリティエラー
+  uint32_t max_loop_counts;  // 1周の最長[タイマRJのカウント]。スニフモード(眠っている時間を含む)を除く
+  uint32_t mode_ms[MODE_COUNT];  // 約49日で一周する
+  uint16_t max_intr_off_counts;  // 割り込み禁止区間の最長[タイマRJのカウント] (INSTRUMENTを定義した時だけ)
+
+  // 1周分の時間を、その周回のモードに計上する。
+  // counts: タイマRJのカウント数(最長の比較用)、ms: ミリ秒クロックの進み(累計用)。
+  // 毎周呼ぶので割り算はせず、usへの変換は表示する時に行う。
+  // ミリ秒クロックの差を足すので端数は失われず、usで積算した時のように約71分で一周することも無い。
+  void loop_done(uint32_t counts, uint32_t ms, Mode m) {
+    ++loops;
+    mode_ms[uint8_t(m)] += ms;
+    if (m != Mode::SNIFF && max_loop_counts < counts)
+      max_loop_counts = counts;
+  }
+};
+
+inline const char* mode_name(Mode m) {
+  switch (m) {
+    case Mode::MAINS:
+    return "MAINS";
+
+    case Mode::SNIFF:
+    return "SNIFF";
+
+    default:
+    return "CONT";
+  }
+}
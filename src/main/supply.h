@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include "diode.h"
+
+// 電圧検出1 (Vdet1) の検出レベル。VD1LS = n の時 2.20V + 0.15V * n
+#define VDET1_BASE_MILLIVOLT 2200
+#define VDET1_STEP_MILLIVOLT 150
+#define VDET1_LEVELS 16
+
+#define SUPPLY_LOW_MILLIVOLT 4300       // DC/DCが昇圧しきれなくなり始めた
+#define SUPPLY_CRITICAL_MILLIVOLT 3700  // LEDが点かず、測定もあてにならない
+
+#define ON_THRESHOLD 800  // 導通の閾値。開放時を1023とした10bit換算(R + R0 が約1.2kΩ)
+#define BRIDGE_VGS_TH_MILLIVOLT 2000  // ブリッジ(TPC8407)のゲートしきい値電圧の目安
+#define BRIDGE_MIN_OVERDRIVE_MILLIVOLT 200
+
+enum class SupplyState : uint8_t {
+  OK,
+  LOW,
+  CRITICAL,
+};
+
+inline uint16_t vdet1_millivolt(uint8_t level) {
+  return VDET1_BASE_MILLIVOLT + uint16_t(VDET1_STEP_MILLIVOLT) * level;
+}
+
+// Vcc >= Vdet1 となる一番高いレベルを二分探索し、Vccの推定値[mV]を返す。
+// above(level) はそのレベルでVccが検出電圧以上ならtrueを返す。
+// 最上位レベル以上ならDC/DCは正常に動作しているので公称値とする。
+template <class F>
+inline uint16_t estimate_vcc(F above) {
+  if (above(VDET1_LEVELS - 1))
+    return VCC_MILLIVOLT;
+  if (! above(0))
+    return VDET1_BASE_MILLIVOLT;
+
+  uint8_t lo = 0;                 // above(lo) == true
+  uint8_t hi = VDET1_LEVELS - 1;  // above(hi) == false
+  while (lo + 1 < hi) {
+    uint8_t mid = (lo + hi) / 2;
+    if (above(mid))
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return vdet1_millivolt(lo) + VDET1_STEP_MILLIVOLT / 2;
+}
+
+// 導通の閾値[OVERSAMPLE_BITSのスケール]
+// R6の上とA/D基準(AVCC)はどちらもVccなので、抵抗による分圧は開放時の値に対する割合で決まり、Vccに依らない。
+// ただしブリッジのゲートはポート出力(Vcc)で駆動するので、Vccが下がるとオン抵抗R0が
+// (Vcal - Vth) / (Vcc - Vth) 倍に増え、同じ被測定物でも測定点の値が上がる。
+// その増分だけ閾値を上げ、閾値に当たる被測定物の抵抗を保つ。
+// 抵抗はRsに対する比(1/4096単位)で計算する。
+inline uint16_t on_threshold_for(const Calibration& cal, uint16_t vcc_mv) {
+  uint16_t t0 = uint32_t(cal.open) * ON_THRESHOLD / ((1 << AD_BITS) - 1);
+  if (cal.open <= t0 || t0 <= cal.shorted)
+    return t0;
+
+  uint32_t xt = uint32_t(t0) * 4096 / (cal.open - t0);                    // (R + R0) / Rs
+  uint32_t x0 = uint32_t(cal.shorted) * 4096 / (cal.open - cal.shorted);  // R0 / Rs (校正時)
+
+  uint16_t lo = BRIDGE_VGS_TH_MILLIVOLT + BRIDGE_MIN_OVERDRIVE_MILLIVOLT;
+  uint16_t vcal = lo < cal.vcc_mv ? cal.vcc_mv : lo;
+  uint16_t vcc = lo < vcc_mv ? vcc_mv : lo;
+  uint32_t x0v = uint32_t(uint64_t(x0) * (vcal - BRIDGE_VGS_TH_MILLIVOLT) / (vcc - BRIDGE_VGS_TH_MILLIVOLT));
+
+  uint32_t x = xt + x0v - x0;
+  return uint16_t(cal.open - uint32_t(cal.open) * 4096 / (4096 + x));
+}
+
+inline SupplyState supply_state(uint16_t mv) {
+  if (mv < SUPPLY_CRITICAL_MILLIVOLT) return SupplyState::CRITICAL;
+  if (mv < SUPPLY_LOW_MILLIVOLT) return SupplyState::LOW;
+  return SupplyState::OK;
+}
+
+inline const char* supply_state_name(SupplyState s) {
+  switch (s) {
+    case SupplyState::LOW:
+    return "LOW";
+
+    case SupplyState::CRITICAL:
+    return "CRITICAL";
+
+    default:
+    return "OK";
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include "M120AN/intr.hpp"
+#include "M120AN/system.hpp"
+#include "M120AN/timer_rj.hpp"
+#include "clock_config.h"
+
+// タイマRJによる1ms周期の単調増加クロック。
+// 割り込みハンドラ(TIMER_RJ_intr)から tick_isr() を呼ぶこと。
+
+#define TICK_COUNTS_PER_MS (F_CLK / 1000)  // 20MHzで20000
+#define TICK_NS_PER_COUNT (1000000000 / F_CLK)  // 20MHzで50
+
+static_assert(F_CLK % 1000 == 0 && TICK_COUNTS_PER_MS <= 65536, "TRJ cannot count 1ms at F_CLK");
+static_assert(1000000000 % F_CLK == 0, "F_CLK must give a whole number of ns per count");
+
+// トレース用タイムスタンプの下位8bitに1msが収まる右シフト量(20MHzで7)
+constexpr uint8_t tick_stamp_shift() {
+  uint8_t s = 0;
+  while (((TICK_COUNTS_PER_MS - 1) >> s) > 255)
+    ++s;
+  return s;
+}
+
+extern volatile uint32_t tick_millis;
+
+// 優先レベルは priority.h の表で設定する
+inline void init_tick() {
+  device::MSTCR.MSTTRJ = false;
+  device::TRJCR.TSTART = false;
+  device::TRJMR = 0;  // タイマモード, f1
+  device::TRJ = TICK_COUNTS_PER_MS - 1;
+  device::TRJIR = device::TRJIR.TRJIE.b();
+  device::TRJCR.TSTART = true;
+}
+
+inline void tick_isr() {
+  tick_millis = tick_millis + 1;
+  device::TRJIR.TRJIF = false;
+}
+
+// 起動からの経過時間[ms]。32bitの読み出しは分割されるので、一致するまで読み直す。
+inline uint32_t now() {
+  uint32_t t;
+  do {
+    t = tick_millis;
+  } while (t != tick_millis);
+  return t;
+}
+
+// 割り込み禁止中でも使える時点の記録。tick_millisは進まないので、TRJとアンダーフローの要求フラグを読む。
+struct TickMark {
+  uint16_t count;
+  bool wrapped;
+};
+
+inline TickMark tick_mark() {
+  TickMark m;
+  do {
+    m.wrapped = device::TRJIR.TRJIF();
+    m.count = device::TRJ();
+  } while (m.wrapped != device::TRJIR.TRJIF());
+  return m;
+}
+
+// tick_millisと時点からの経過カウント数。
+// アンダーフローの割り込みがまだ処理されていなければ(割り込み禁止中や、読んだ直後に割り込みが入る場合)、
+// TRJは再設定済みでもtick_millisは古いので1ms足す。
+inline uint32_t tick_counts(uint32_t ms, TickMark m) {
+  if (m.wrapped)
+    ++ms;
+  return ms * TICK_COUNTS_PER_MS + (TICK_COUNTS_PER_MS - 1 - m.count);
+}
+
+// 起動からの経過時間[1カウント = 50ns]。短い区間の計測用で約3.6分で一周する。
+inline uint32_t now_counts() {
+  uint32_t ms;
+  TickMark m;
+  do {
+    ms = tick_millis;
+    m = tick_mark();
+  } while (ms != tick_millis);
+  return tick_counts(ms, m);
+}
+
+// 2つの時点の間のカウント数。アンダーフローは1回までしか分からないので、2ms未満の区間に使う。
+inline uint16_t tick_elapsed(TickMark from, TickMark to) {
+  int32_t d = int32_t(from.count) - to.count;  // TRJは減算カウント
+  if (d < 0 || (! from.wrapped && to.wrapped))
+    d += TICK_COUNTS_PER_MS;
+  return uint16_t(d);
+}
+
+// カウント数[us]。F_CLKが1MHzの倍数なら割り算1回で済む。
+inline uint32_t tick_counts_to_us(uint32_t c) {
+  if constexpr (TICK_COUNTS_PER_MS % 1000 == 0)
+    return c / (TICK_COUNTS_PER_MS / 1000);
+  else
+    return uint32_t(uint64_t(c) * 1000 / TICK_COUNTS_PER_MS);
+}
+
+// トレース用の16bitタイムスタンプ。
+// 上位8bitは経過時間[ms]の下位8bit、下位8bitはその1ms内の経過を2^tick_stamp_shift()カウント単位で表す。
+// 20MHzを2^nで分周したクロックでは、どれも6.4us単位になる。256msで一周する。
+inline uint16_t now_stamp() {
+  uint8_t ms;
+  TickMark m;
+  do {
+    ms = uint8_t(tick_millis);
+    m = tick_mark();
+  } while (ms != uint8_t(tick_millis));
+  if (m.wrapped)
+    ++ms;
+  return (uint16_t(ms) << 8) | ((TICK_COUNTS_PER_MS - 1 - m.count) >> tick_stamp_shift());
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+// イベントトレース
+// 1バイトのイベントIDと16bitのタイムスタンプをリングバッファに記録する。
+// 記録は配列2つへの書き込みと添字の更新だけ。割り込みと競合すると1件失われることがある。
+// tools/trace2chrome.py でChromeのトレース形式(JSON)に変換できる。
+//
+// ID: 0x01〜0x3f 単発のイベント
+//     0x40〜0x7f 区間の開始, (開始ID | TRACE_END) で区間の終了
+
+#define TRACE_END 0x80
+
+enum TraceId : uint8_t {
+  TRACE_LOOP = 0x01,         // メインループの先頭
+  TRACE_AD_DONE = 0x02,      // A/D変換完了
+  TRACE_CONTACT = 0x03,      // 導通状態の変化
+  TRACE_RETUNE = 0x04,       // ブザーの周波数変更
+  TRACE_SNIFF_STOP = 0x05,   // ストップモードへ
+  TRACE_SNIFF_WAKE = 0x06,   // ストップモードから復帰
+  TRACE_FAULT = 0x07,        // 監視によるリセット
+
+  TRACE_UART_TX = 0x40,      // UART0_TX_intr (TRACE_UART を定義した時だけ)
+  TRACE_UART_RX = 0x41,      // UART0_RX_intr (TRACE_UART を定義した時だけ)
+  TRACE_TIMER_RB = 0x42,     // TIMER_RB_intr (電源周期同期モード, プロファイラ)
+  TRACE_WATCHDOG = 0x43,     // WATCHDOG_intr
+  TRACE_ACQUIRE = 0x44,      // 1回分の測定
+  TRACE_COMMAND = 0x45,      // コマンド処理
+};
+
+// 電源を入れ直すまで内容を保つため、.noinitに置けるようコンストラクタを持たない。
+// 使う前に clear() を呼ぶこと。
+template <uint8_t N>
+struct TraceBuffer {
+  static_assert((N & (N - 1)) == 0, "N must be a power of 2");
+
+  uint8_t ids[N];
+  uint16_t stamps[N];
+  uint8_t head;      // 次に書く位置
+  uint8_t count;
+  bool frozen;
+
+  void clear() {
+    head = 0;
+    count = 0;
+    frozen = false;
+  }
+
+  void record(uint8_t id, uint16_t stamp) {
+    if (frozen)
+      return;
+    uint8_t i = head;
+    ids[i] = id;
+    stamps[i] = stamp;
+    head = (i + 1) & (N - 1);
+    if (count < N)
+      ++count;
+  }
+
+  // 古い方からn番目の位置
+  uint8_t index(uint8_t n) const {
+    return (head - count + n) & (N - 1);
+  }
+
+  // リセットを越えて残っていた内容の添字を範囲内に収める
+  void sanitize() {
+    head &= N - 1;
+    if (N < count)
+      count = N;
+  }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+// UARTの高速モード
+// H<kbaud> を受けたら今の速度で応答してから切り替え、相手が新しい速度で同じ H<kbaud> を送ってきたら確定する。
+// LINK_CONFIRM_MS 以内に確定しない時と、LINK_WINDOW_MS の間に LINK_MAX_ERRORS 回以上
+// 受信エラー(フレーミング・オーバーラン・パリティ)が起きた時は、既定の速度に戻す。
+// 受信エラーの数は割り込みが数える8bitのカウンタをそのまま渡す(差だけを見るので一周してよい)。
+
+#define LINK_CONFIRM_MS 1000
+#define LINK_WINDOW_MS 1000
+#define LINK_MAX_ERRORS 4
+
+enum class LinkState : uint8_t {
+  DEFAULT,  // 既定の速度
+  PENDING,  // 切り替えた速度で確認を待っている
+  FAST,     // 確認が済んだ
+};
+
+class UartLink {
+  LinkState state_ = LinkState::DEFAULT;
+  uint8_t rate_ = 0;     // 速度表の位置(0は既定の速度)
+  uint8_t errors_ = 0;   // 切り替え/窓の始めの受信エラー数
+  uint32_t since_ = 0;   // 切り替え/窓の始めの時刻[ms]
+
+public:
+  LinkState state() const { return state_; }
+  uint8_t rate() const { return rate_; }
+
+  // 速度を切り替えた。rate = 0 は既定の速度に戻した
+  void request(uint8_t rate, uint8_t errors, uint32_t now) {
+    state_ = rate ? LinkState::PENDING : LinkState::DEFAULT;
+    rate_ = rate;
+    errors_ = errors;
+    since_ = now;
+  }
+
+  // 切り替えた速度で同じ要求が届いた。確定したらtrue
+  bool confirm(uint8_t rate, uint8_t errors, uint32_t now) {
+    if (state_ != LinkState::PENDING || rate != rate_)
+      return false;
+    state_ = LinkState::FAST;
+    errors_ = errors;
+    since_ = now;
+    return true;
+  }
+
+  // 定期的に呼ぶ。既定の速度に戻す時はtrueを返し、DEFAULTになる
+  bool check(uint8_t errors, uint32_t now) {
+    if (state_ == LinkState::DEFAULT)
+      return false;
+
+    uint8_t e = errors - errors_;
+    bool expired = (state_ == LinkState::PENDING ? LINK_CONFIRM_MS : LINK_WINDOW_MS) <= now - since_;
+    if (LINK_MAX_ERRORS <= e || (state_ == LinkState::PENDING && expired)) {
+      request(0, errors, now);
+      return true;
+    }
+
+    if (expired) {  // 次の窓
+      errors_ = errors;
+      since_ = now;
+    }
+    return false;
+  }
+};
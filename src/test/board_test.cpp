@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include "board.h"
+
+typedef utils::port_map PM;
+
+TEST(BoardTest, Registers) {
+    EXPECT_EQ(0x00, board::pins.pm(1, false));
+    EXPECT_EQ(0x05, board::pins.pm(1, true));   // TXD0, RXD0
+    EXPECT_EQ(0x00, board::pins.pme(1));
+    EXPECT_EQ(0xc0, board::pins.pm(3, true));   // TRCIOD
+    EXPECT_EQ(0x8c, board::pins.pd(1));
+    EXPECT_EQ(0x80, board::pins.p(1));          // 電源保持
+    EXPECT_EQ(0xc0, board::pins.pd(4));
+    EXPECT_EQ(0x00, board::pins.p(4));
+    EXPECT_FALSE(board::pins.conflict());
+    EXPECT_TRUE(board::pins.valid());
+}
+
+TEST(BoardTest, Extended) {
+    constexpr auto m = utils::make_pin_mux(PM::pin(PM::P14::TRCIOB), PM::pin(PM::P46::TRJIO));
+    EXPECT_EQ(0x00, m.pm(1, true));
+    EXPECT_EQ(0x01, m.pme(1));
+    EXPECT_EQ(0x10, m.pm(4, true));
+    EXPECT_EQ(0x10, m.pme(4));
+}
+
+TEST(BoardTest, Conflict) {
+    constexpr auto m = utils::make_pin_mux(PM::pin(PM::P14::TXD0), PM::pin(PM::P14::PORT).out());
+    static_assert(m.conflict(), "");
+    constexpr auto n = utils::make_pin_mux(PM::pin(PM::P14::TXD0), PM::pin(PM::P42::TXD0));
+    static_assert(!n.conflict(), "");
+}
+
+TEST(BoardTest, Valid) {
+    constexpr auto m = utils::make_pin_mux(utils::pin_t { 3, 0, 0, true, false });
+    static_assert(!m.valid(), "");
+    constexpr auto n = utils::make_pin_mux(utils::pin_t { 1, 3, 4, false, false });
+    static_assert(!n.valid(), "");
+}
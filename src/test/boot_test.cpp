@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+#include "boot.h"
+
+TEST(BootTest, Mark) {
+    BootLog log = {};
+    log.mark(BootStage::MAIN, 120);
+    log.mark(BootStage::READY, 11500);
+    EXPECT_EQ(uint32_t(120), log.us[0]);
+    EXPECT_EQ(uint32_t(11500), log.ready_us());
+}
+
+TEST(BootTest, Name) {
+    EXPECT_STREQ("MAIN", boot_stage_name(BootStage::MAIN));
+    EXPECT_STREQ("RESULT", boot_stage_name(BootStage::RESULT));
+    EXPECT_STREQ("READY", boot_stage_name(BootStage::READY));
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include "calib_store.h"
+
+// 消去したブロック
+struct Block {
+    CalibrationRecord slots[8];
+
+    Block() { std::memset(slots, 0xff, sizeof(slots)); }
+};
+
+TEST(CalibStoreTest, BlankKeepsDefault) {
+    Block b;
+    Calibration cal = CALIBRATION_DEFAULT;
+    EXPECT_EQ(0, calibration_free_slot(b.slots, 8));
+    EXPECT_FALSE(load_calibration(b.slots, 8, cal));
+    EXPECT_EQ(to_oversample_scale(1023), cal.open);
+    EXPECT_EQ(0, cal.shorted);
+}
+
+TEST(CalibStoreTest, LoadsLastRecord) {
+    Block b;
+    b.slots[0] = make_calibration_record(Calibration { 8000, 20, 5000 });
+    b.slots[1] = make_calibration_record(Calibration { 7900, 30, 4800 });
+    EXPECT_EQ(2, calibration_free_slot(b.slots, 8));
+
+    Calibration cal = CALIBRATION_DEFAULT;
+    EXPECT_TRUE(load_calibration(b.slots, 8, cal));
+    EXPECT_EQ(7900, cal.open);
+    EXPECT_EQ(30, cal.shorted);
+    EXPECT_EQ(4800, cal.vcc_mv);
+}
+
+TEST(CalibStoreTest, SkipsBrokenRecord) {
+    Block b;
+    b.slots[0] = make_calibration_record(Calibration { 8000, 20, 5000 });
+    // 書き込み中に電源が切れた
+    b.slots[1] = make_calibration_record(Calibration { 7900, 30, 4800 });
+    reinterpret_cast<uint8_t*>(&b.slots[1])[5] = 0xff;
+
+    Calibration cal = CALIBRATION_DEFAULT;
+    EXPECT_TRUE(load_calibration(b.slots, 8, cal));
+    EXPECT_EQ(8000, cal.open);
+
+    // 有効な記録が無い
+    b.slots[0].magic = 0;
+    cal = CALIBRATION_DEFAULT;
+    EXPECT_FALSE(load_calibration(b.slots, 8, cal));
+    EXPECT_EQ(to_oversample_scale(1023), cal.open);
+}
+
+TEST(CalibStoreTest, RejectsImplausibleValues) {
+    Block b;
+    b.slots[0] = make_calibration_record(Calibration { 100, 200, 5000 });  // 開放と短絡が逆
+    Calibration cal = CALIBRATION_DEFAULT;
+    EXPECT_FALSE(load_calibration(b.slots, 8, cal));
+    EXPECT_FALSE(is_valid_calibration(Calibration { 9000, 0, 5000 }));  // 10bitを超える
+    EXPECT_FALSE(is_valid_calibration(Calibration { 8000, 0, 0 }));  // Vccが分からない
+    EXPECT_TRUE(is_valid_calibration(CALIBRATION_DEFAULT));
+}
+
+TEST(CalibStoreTest, FullBlock) {
+    Block b;
+    for (int i = 0; i < 8; ++i)
+        b.slots[i] = make_calibration_record(Calibration { uint16_t(8000 - i), 0, 5000 });
+    EXPECT_EQ(8, calibration_free_slot(b.slots, 8));
+    Calibration cal = CALIBRATION_DEFAULT;
+    EXPECT_TRUE(load_calibration(b.slots, 8, cal));
+    EXPECT_EQ(7993, cal.open);
+}
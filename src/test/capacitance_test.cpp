@@ -0,0 +1,18 @@
+#include <gtest/gtest.h>
+#include "capacitance.h"
+
+TEST(CapacitanceTest, Threshold) {
+    Calibration cal = { 8000, 1000 };
+    EXPECT_EQ(1000 + 4424, charge_threshold(cal));
+}
+
+TEST(CapacitanceTest, ToNanofarad) {
+    // 330Ω * 10uF = 3.3ms
+    EXPECT_EQ(uint32_t(10000), to_nanofarad(3300000));
+}
+
+TEST(CapacitanceTest, IsCharging) {
+    EXPECT_TRUE(is_charging(1000, 2000));
+    EXPECT_FALSE(is_charging(1000, 1010));
+    EXPECT_FALSE(is_charging(2000, 1000));
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "clock_config.h"
+#include "mains.h"
+#include "profile.h"
+#include "tick.h"
+
+TEST(ClockConfigTest, Phissel) {
+    EXPECT_EQ(0, clock_phissel(20000000));
+    EXPECT_EQ(2, clock_phissel(5000000));
+    EXPECT_EQ(7, clock_phissel(8000000));
+}
+
+TEST(ClockConfigTest, Uart) {
+    UartSetting s = uart_setting(20000000, 115200);
+    EXPECT_EQ(0, s.clk);
+    EXPECT_EQ(10, s.brg);
+    EXPECT_EQ(uint32_t(113636), s.baud);
+    EXPECT_EQ(uint32_t(13), uart_error_permille(115200, s));
+    EXPECT_TRUE(uart_reachable(20000000, 115200));
+
+    EXPECT_FALSE(uart_reachable(5000000, 115200));
+    EXPECT_TRUE(uart_reachable(5000000, 38400));
+
+    s = uart_setting(20000000, 300);  // f1では足りない
+    EXPECT_EQ(2, s.clk);
+}
+
+TEST(ClockConfigTest, TimerRb) {
+    EXPECT_EQ(uint32_t(12500), MAINS_TIMING_50.counts());
+    EXPECT_GE(uint32_t(MAINS_MAX_ERROR_PPM), timer_rb_error_ppm(mains_counts(60), MAINS_TIMING_60));
+    EXPECT_EQ(uint32_t(20060), PROFILE_TIMING.counts());
+
+    TimerRbSetting s = timer_rb_setting(100000);  // f1では16ビットを超える
+    EXPECT_EQ(3, s.tck);
+    EXPECT_EQ(uint32_t(100000), s.counts());
+    EXPECT_EQ(0, timer_rb_setting(10000000).div);
+}
+
+TEST(ClockConfigTest, Tick) {
+    EXPECT_EQ(20000, TICK_COUNTS_PER_MS);
+    EXPECT_EQ(7, tick_stamp_shift());
+    EXPECT_EQ(uint32_t(1234), tick_counts_to_us(1234 * 20 + 19));
+}
@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+#include "command.h"
+
+static bool feed_all(CommandReader& r, const char* s, Command& cmd) {
+    bool done = false;
+    while (*s) done = r.feed(*s++, cmd);
+    return done;
+}
+
+TEST(CommandReaderTest, WithArg) {
+    CommandReader r;
+    Command cmd;
+    EXPECT_TRUE(feed_all(r, "O16\r", cmd));
+    EXPECT_EQ('O', cmd.name);
+    EXPECT_TRUE(cmd.has_arg);
+    EXPECT_EQ(16, cmd.arg);
+}
+
+TEST(CommandReaderTest, WithoutArg) {
+    CommandReader r;
+    Command cmd;
+    EXPECT_FALSE(feed_all(r, "\r\n", cmd));
+    EXPECT_TRUE(feed_all(r, "s\n", cmd));
+    EXPECT_EQ('s', cmd.name);
+    EXPECT_FALSE(cmd.has_arg);
+}
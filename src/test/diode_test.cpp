@@ -0,0 +1,21 @@
+#include <gtest/gtest.h>
+#include "diode.h"
+
+TEST(DiodeTest, ForwardVoltage) {
+    Calibration cal = CALIBRATION_DEFAULT;
+    // 2.0V の点の A/D 値
+    uint16_t v = uint16_t(uint32_t(cal.open) * 2000 / VCC_MILLIVOLT);
+    EXPECT_NEAR(2000, forward_millivolt(v, cal, VCC_MILLIVOLT), 2);
+
+    // オン抵抗 R0 = 33Ω (Vs = Vo / 11): 電流 (5 - 2) / 330 = 9.1mA で 0.3V 降下
+    cal.shorted = cal.open / 11;
+    EXPECT_NEAR(1700, forward_millivolt(v, cal, VCC_MILLIVOLT), 3);
+}
+
+TEST(DiodeTest, Classify) {
+    EXPECT_EQ(DiodeClass::SCHOTTKY, classify_diode(300));
+    EXPECT_EQ(DiodeClass::SILICON, classify_diode(650));
+    EXPECT_EQ(DiodeClass::LED_RED_YELLOW, classify_diode(1900));
+    EXPECT_EQ(DiodeClass::LED_GREEN_BLUE_WHITE, classify_diode(2900));
+    EXPECT_EQ(DiodeClass::UNKNOWN, classify_diode(4000));
+}
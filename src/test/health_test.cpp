@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "health.h"
+
+TEST(HealthTest, Supervisor) {
+    const uint8_t all = stage_bit(Stage::ACQUIRE) | stage_bit(Stage::CLASSIFY)
+        | stage_bit(Stage::ACTUATE) | stage_bit(Stage::TELEMETRY);
+    Supervisor sv;
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(STAGE_NONE, sv.tick(all));
+
+    // 測定だけが止まった
+    const uint8_t stuck = all & ~stage_bit(Stage::ACQUIRE);
+    for (int i = 1; i < stage_deadlines[0]; ++i)
+        EXPECT_EQ(STAGE_NONE, sv.tick(stuck));
+    EXPECT_EQ(uint8_t(Stage::ACQUIRE), sv.tick(stuck));
+
+    // 一度でもチェックインすれば数え直し
+    Supervisor sv2;
+    EXPECT_EQ(STAGE_NONE, sv2.tick(0));
+    EXPECT_EQ(STAGE_NONE, sv2.tick(all));
+    for (int i = 1; i < stage_deadlines[3]; ++i)
+        EXPECT_EQ(STAGE_NONE, sv2.tick(stage_bit(Stage::ACQUIRE) | stage_bit(Stage::CLASSIFY) | stage_bit(Stage::ACTUATE)));
+}
+
+TEST(HealthTest, ResetRecord) {
+    ResetRecord r = { 0x1234, 2, 99 };
+    EXPECT_EQ(STAGE_NONE, take_reset_stage(r));
+    EXPECT_EQ(0, r.count);
+
+    record_reset(r, uint8_t(Stage::TELEMETRY));
+    EXPECT_EQ(uint8_t(Stage::TELEMETRY), take_reset_stage(r));
+    EXPECT_EQ(STAGE_NONE, take_reset_stage(r));
+    EXPECT_EQ(1, r.count);
+}
+
+TEST(HealthTest, MissingStage) {
+    EXPECT_EQ(STAGE_NONE, missing_stage(STAGE_ALL));
+    EXPECT_EQ(uint8_t(Stage::ACQUIRE), missing_stage(0));
+    EXPECT_EQ(uint8_t(Stage::ACTUATE), missing_stage(stage_bit(Stage::ACQUIRE) | stage_bit(Stage::CLASSIFY)));
+    EXPECT_EQ(uint8_t(Stage::TELEMETRY), missing_stage(STAGE_ALL & ~stage_bit(Stage::TELEMETRY)));
+}
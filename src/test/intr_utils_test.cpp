@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "common/intr_utils.hpp"
+
+namespace {
+    bool intr_enabled;
+    int windows;
+
+    struct mock_flag {
+        static uint16_t save_and_disable() {
+            uint16_t flg = intr_enabled ? 0x40 : 0;
+            intr_enabled = false;
+            return flg;
+        }
+        static bool enabled(uint16_t flg) { return flg & 0x40; }
+        static void restore(uint16_t flg) { if (enabled(flg)) intr_enabled = true; }
+    };
+
+    struct mock_watch {
+        static void begin() { ++windows; }
+        static void end() { }
+    };
+
+    typedef utils::critical_t<mock_flag, mock_watch> critical;
+}
+
+TEST(IntrUtilsTest, Nest) {
+    intr_enabled = true;
+    windows = 0;
+    {
+        critical outer;
+        EXPECT_FALSE(intr_enabled);
+        {
+            critical inner;
+            EXPECT_FALSE(intr_enabled);
+        }
+        EXPECT_FALSE(intr_enabled);  // 内側を出ても禁止のまま
+    }
+    EXPECT_TRUE(intr_enabled);
+    EXPECT_EQ(1, windows);  // 計測は一番外側だけ
+}
+
+TEST(IntrUtilsTest, AlreadyDisabled) {
+    intr_enabled = false;
+    windows = 0;
+    {
+        critical cs;
+    }
+    EXPECT_FALSE(intr_enabled);  // 割り込み処理の中などでは許可しない
+    EXPECT_EQ(0, windows);
+}
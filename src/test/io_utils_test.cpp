@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "common/io_utils.hpp"
+
+using namespace device;
+
+// アクセス回数を数える8bitレジスタ
+struct mock_reg8 {
+    typedef uint8_t value_type;
+    static uint8_t value;
+    static int reads;
+    static int writes;
+
+    static void reset(uint8_t v) { value = v; reads = 0; writes = 0; }
+    static value_type read() { ++reads; return value; }
+    static void write(value_type v) { ++writes; value = v; }
+};
+
+uint8_t mock_reg8::value;
+int mock_reg8::reads;
+int mock_reg8::writes;
+
+static bit_rw_t<mock_reg8, bitpos::B0> B0;
+static bit_rw_t<mock_reg8, bitpos::B3> B3;
+static bits_rw_t<mock_reg8, bitpos::B4, 3> F4;
+static bits_rw_t<mock_reg8, bitpos::B0, 4> L4;
+static bit_rw_t<mock_reg8, bitpos::B7> B7;
+
+TEST(IoUtilsTest, SingleReadModifyWrite) {
+    mock_reg8::reset(0x8a);
+    update(B0.f(true) | B3.f(false) | F4.f(5));
+    EXPECT_EQ(1, mock_reg8::reads);
+    EXPECT_EQ(1, mock_reg8::writes);
+    EXPECT_EQ(0xd3, mock_reg8::value);
+}
+
+TEST(IoUtilsTest, WriteOnlyWhenAllBitsGiven) {
+    mock_reg8::reset(0xff);
+    update(L4.f(0x6) | F4.f(0x1) | B7.f(false));
+    EXPECT_EQ(0, mock_reg8::reads);
+    EXPECT_EQ(1, mock_reg8::writes);
+    EXPECT_EQ(0x16, mock_reg8::value);
+}
+
+TEST(IoUtilsTest, LaterFieldWins) {
+    constexpr auto f = B3.f(true) | B3.f(false);
+    static_assert(f.mask == 0x08, "mask");
+    static_assert(f.value == 0x00, "value");
+
+    mock_reg8::reset(0x08);
+    update(f);
+    EXPECT_EQ(0x00, mock_reg8::value);
+}
+
+TEST(IoUtilsTest, FieldValueIsMasked) {
+    static_assert(F4.f(0xff).value == 0x70, "value");
+}
@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+#include "iv.h"
+
+TEST(IvTest, ToIvPoint) {
+    Calibration cal = CALIBRATION_DEFAULT;
+    IvPoint p = to_iv_point(0, cal, VCC_MILLIVOLT, 200, 200);
+    EXPECT_EQ(0, p.millivolt);
+    EXPECT_EQ(15151, p.microamp);
+
+    p = to_iv_point(cal.open, cal, VCC_MILLIVOLT, 200, 200);
+    EXPECT_EQ(VCC_MILLIVOLT, p.millivolt);
+    EXPECT_EQ(0, p.microamp);
+
+    // 1.7V: (5 - 1.7) / 330 = 10mA
+    p = to_iv_point(uint16_t(uint32_t(cal.open) * 1700 / VCC_MILLIVOLT), cal, VCC_MILLIVOLT, 200, 200);
+    EXPECT_NEAR(1700, p.millivolt, 2);
+    EXPECT_NEAR(10000, p.microamp, 10);
+}
+
+TEST(IvTest, DutyAveraged) {
+    Calibration cal = CALIBRATION_DEFAULT;
+    // 平滑されない場合: オン期間は1.7V / 10mA、オフ期間は0Vで、デューティ比50%の平均
+    uint16_t on = uint16_t(uint32_t(cal.open) * 1700 / VCC_MILLIVOLT);
+    IvPoint full = to_iv_point(on, cal, VCC_MILLIVOLT, 200, 200);
+    IvPoint half = to_iv_point(on / 2, cal, VCC_MILLIVOLT, 100, 200);
+    EXPECT_NEAR(full.millivolt / 2, half.millivolt, 2);
+    EXPECT_NEAR(full.microamp / 2, half.microamp, 10);
+
+    // 開放: 測定点は駆動電圧の平均と同じで、電流は流れない
+    IvPoint open = to_iv_point(cal.open / 4, cal, VCC_MILLIVOLT, 50, 200);
+    EXPECT_NEAR(VCC_MILLIVOLT / 4, open.millivolt, 2);
+    EXPECT_EQ(0, open.microamp);
+}
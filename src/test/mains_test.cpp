@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "mains.h"
+
+TEST(SyncIntegratorTest, IntegratesOnePeriodPerPolarity) {
+    SyncIntegrator integrator;
+    uint16_t plus = 0, minus = 0;
+    int switched = 0;
+    bool done = false;
+
+    for (int i = 0; i < 2 * (MAINS_SETTLE_SAMPLES + MAINS_SAMPLES); ++i) {
+        bool was_plus = integrator.is_plus();
+        // 切り替え直後は捨てられる値。積分区間では正弦波状のリプルを乗せる。
+        uint16_t v = was_plus ? 500 : 900;
+        int k = i % (MAINS_SETTLE_SAMPLES + MAINS_SAMPLES);
+        if (k < MAINS_SETTLE_SAMPLES) v = 1023;
+        else v += (k % 2) ? 40 : -40;
+        done = integrator.feed(v, plus, minus);
+        if (integrator.is_plus() != was_plus) ++switched;
+    }
+
+    EXPECT_TRUE(done);
+    EXPECT_EQ(2, switched);
+    EXPECT_EQ(to_oversample_scale(500), plus);
+    EXPECT_EQ(to_oversample_scale(900), minus);
+}
+
+// 電源の正弦波(基本波と第3高調波)をタイマRBの実際の周期で標本化し、DCの値だけが残ることを確かめる
+static void integrate_mains(uint8_t hz, double phase, uint16_t& plus, uint16_t& minus) {
+    const double pi = 3.14159265358979;
+    double period_s = double(mains_timing(hz).counts()) / F_CLK;
+    SyncIntegrator integrator;
+    bool done = false;
+    for (int i = 0; ! done; ++i) {
+        double w = 2 * pi * hz * i * period_s + phase;
+        double dc = integrator.is_plus() ? 500 : 900;
+        double v = dc + 100 * std::sin(w) + 30 * std::sin(3 * w);
+        done = integrator.feed(uint16_t(std::lround(v)), plus, minus);
+    }
+}
+
+TEST(SyncIntegratorTest, RejectsMainsSinusoid) {
+    for (uint8_t hz : { 50, 60 }) {
+        for (double phase : { 0.0, 0.7, 2.0, 4.5 }) {
+            uint16_t plus = 0, minus = 0;
+            integrate_mains(hz, phase, plus, minus);
+            // 標本毎の丸め誤差の分だけ許す
+            EXPECT_NEAR(to_oversample_scale(500), plus, 2) << int(hz) << "Hz phase " << phase;
+            EXPECT_NEAR(to_oversample_scale(900), minus, 2) << int(hz) << "Hz phase " << phase;
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+#include "oversample.h"
+
+TEST(OversampleTest, Decimate) {
+    EXPECT_EQ(uint16_t(8184), decimate(1023 * 4, 2));
+    EXPECT_EQ(uint16_t(8184), decimate(1023 * 16, 4));
+    EXPECT_EQ(uint16_t(8184), decimate(uint16_t(1023 * 64), 6));
+    EXPECT_EQ(uint16_t(to_oversample_scale(800)), decimate(800 * 8, 3));
+    EXPECT_EQ(uint16_t(3), decimate(5, 4));
+}
+
+TEST(OversampleTest, EffectiveBits) {
+    EXPECT_EQ(11, effective_bits(2));
+    EXPECT_EQ(12, effective_bits(4));
+    EXPECT_EQ(13, effective_bits(6));
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "priority.h"
+#include "isr_timing.h"
+
+typedef device::VECTOR V;
+
+TEST(PriorityTest, Registers) {
+    EXPECT_EQ(0x13, priority::plan.ilvl(0xB));  // TIMER_RJ 3, WATCHDOG 1
+    EXPECT_EQ(0x02, priority::plan.ilvl(0xC));  // TIMER_RB 2
+    EXPECT_EQ(0x10, priority::plan.ilvl(0x8));  // UART0_TX 1
+    EXPECT_EQ(0x01, priority::plan.ilvl(0x9));  // UART0_RX 1
+    EXPECT_EQ(0x00, priority::plan.ilvl(0x3));  // TIMER_RC は使わない
+    EXPECT_FALSE(priority::plan.conflict());
+    EXPECT_TRUE(priority::plan.valid());
+}
+
+TEST(PriorityTest, Levels) {
+    EXPECT_EQ(2, priority::plan.level(V::TIMER_RB));
+    EXPECT_EQ(0, priority::plan.level(V::ADC));
+    EXPECT_EQ(priority::plan.size(), priority::plan.index(V::ADC));
+    EXPECT_EQ(1, priority::plan.max_level(uint8_t(IntrGroup::TELEMETRY)));
+    EXPECT_EQ(2, priority::plan.min_level(uint8_t(IntrGroup::MEASURE)));
+}
+
+TEST(PriorityTest, Invalid) {
+    constexpr auto twice = device::make_intr_plan(
+        device::intr_level_t { V::UART0_TX, 1, 0, "A" },
+        device::intr_level_t { V::UART0_TX, 2, 0, "B" });
+    static_assert(twice.conflict(), "");
+
+    constexpr auto brk = device::make_intr_plan(device::intr_level_t { V::BRK, 1, 0, "A" });
+    static_assert(! brk.valid(), "");
+    constexpr auto off = device::make_intr_plan(device::intr_level_t { V::ADC, 0, 0, "A" });
+    static_assert(! off.valid(), "");
+    constexpr auto high = device::make_intr_plan(device::intr_level_t { V::ADC, 4, 0, "A" });
+    static_assert(! high.valid(), "");
+}
+
+TEST(IsrTimingTest, Record) {
+    IsrTiming t = {};
+    t.exec(40);
+    t.exec(30);
+    EXPECT_EQ(uint32_t(2), t.count);
+    EXPECT_EQ(40, t.max_exec);
+    EXPECT_FALSE(t.has_latency);
+    t.latency(12);
+    t.latency(5);
+    EXPECT_TRUE(t.has_latency);
+    EXPECT_EQ(12, t.max_latency);
+}
+
+TEST(IsrTimingTest, TimerRbElapsed) {
+    EXPECT_EQ(0, timer_rb_elapsed(84, 117, 84, 117));  // 再設定の直後
+    EXPECT_EQ(3, timer_rb_elapsed(84, 117, 81, 117));
+    EXPECT_EQ(85 + 1, timer_rb_elapsed(84, 117, 83, 116));
+}
@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+#include "profile.h"
+
+TEST(ProfileTest, Record) {
+    ProfileHistogram h;
+    h.clear();
+    h.record(0x8000);
+    h.record(0x81ff);
+    h.record(0x8200);
+    h.record(0xffff);
+    h.record(0x10000);
+    h.record(0x0400);
+
+    EXPECT_EQ(6, h.samples);
+    EXPECT_EQ(2, h.buckets[0]);
+    EXPECT_EQ(1, h.buckets[1]);
+    EXPECT_EQ(1, h.buckets[PROFILE_BUCKETS - 1]);
+    EXPECT_EQ(2, h.outside);
+    EXPECT_EQ(uint32_t(0x8200), ProfileHistogram::bucket_address(1));
+}
+
+TEST(ProfileTest, Saturate) {
+    ProfileHistogram h;
+    h.clear();
+    h.samples = UINT16_MAX;
+    h.record(0x8000);
+    EXPECT_EQ(0, h.buckets[0]);
+}
@@ -0,0 +1,24 @@
+#include <gtest/gtest.h>
+#include "resistance.h"
+
+// 理想的なA/D値 (OVERSAMPLE_BITSスケール)
+static uint16_t ideal(uint32_t milliohm, uint32_t r0_milliohm, uint16_t vo) {
+    uint32_t r = milliohm + r0_milliohm;
+    return uint16_t(uint64_t(vo) * r / (uint64_t(SENSE_OHMS) * 1000 + r) + 0.5);
+}
+
+TEST(ResistanceTest, Default) {
+    Calibration cal = CALIBRATION_DEFAULT;
+    EXPECT_EQ(uint32_t(0), to_milliohm(0, cal));
+    EXPECT_NEAR(10000, to_milliohm(ideal(10000, 0, cal.open), cal), 50);
+    EXPECT_NEAR(1000000, to_milliohm(ideal(1000000, 0, cal.open), cal), 2000);
+    EXPECT_EQ(RESISTANCE_OPEN, to_milliohm(cal.open, cal));
+}
+
+TEST(ResistanceTest, Calibrated) {
+    // DC/DC出力が低め、ブリッジのオン抵抗が2Ω
+    Calibration cal = { 7900, ideal(0, 2000, 7900) };
+    EXPECT_NEAR(1000, to_milliohm(ideal(1000, 2000, 7900), cal), 60);
+    EXPECT_NEAR(100000, to_milliohm(ideal(100000, 2000, 7900), cal), 600);
+    EXPECT_EQ(RESISTANCE_OPEN, to_milliohm(8000, cal));
+}
@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+#include "sniff.h"
+
+TEST(SniffTest, AverageCurrent) {
+    EXPECT_EQ(SNIFF_STOP_MICROAMP, sniff_average_microamp(0));
+    EXPECT_EQ(43, sniff_average_microamp(1000));
+    EXPECT_EQ(SNIFF_RUN_MICROAMP, sniff_average_microamp(uint32_t(SNIFF_PERIOD_MS) * 1000));
+    EXPECT_EQ(99, sniff_reduction_percent(43));
+    EXPECT_EQ(0, sniff_reduction_percent(SNIFF_RUN_MICROAMP));
+}
+
+TEST(SniffTest, Timing) {
+    EXPECT_EQ(SNIFF_PERIOD_MAX_MS + 2, sniff_worst_delay_ms(1200));
+    EXPECT_EQ(SNIFF_PERIOD_MS - 1, sniff_asleep_ms(1200));
+    EXPECT_EQ(0, sniff_asleep_ms(uint32_t(200) * 1000));
+}
@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+#include "stats.h"
+
+TEST(StatsTest, LoopDone) {
+    Stats s = {};
+    s.loop_done(24000, 1, Mode::CONTINUOUS);
+    s.loop_done(16000, 1, Mode::CONTINUOUS);
+    s.loop_done(2620000, 131, Mode::SNIFF);
+    s.loop_done(1000000, 50, Mode::MAINS);
+
+    EXPECT_EQ(uint32_t(4), s.loops);
+    EXPECT_EQ(uint32_t(2), s.mode_ms[uint8_t(Mode::CONTINUOUS)]);
+    EXPECT_EQ(uint32_t(131), s.mode_ms[uint8_t(Mode::SNIFF)]);
+    EXPECT_EQ(uint32_t(1000000), s.max_loop_counts);
+}
+
+TEST(StatsTest, ModeTimeDoesNotWrap) {
+    Stats s = {};
+    // 2時間分の10ms周回: usで積算すると2^32usを超える
+    for (uint32_t i = 0; i < 720000; ++i)
+        s.loop_done(200000, 10, Mode::CONTINUOUS);
+    EXPECT_EQ(uint32_t(7200000), s.mode_ms[uint8_t(Mode::CONTINUOUS)]);
+
+    // 1ms未満の周回はミリ秒クロックが進んだ周回にまとめて計上される
+    for (int i = 0; i < 4; ++i)
+        s.loop_done(5000, i == 3 ? 1 : 0, Mode::MAINS);
+    EXPECT_EQ(uint32_t(1), s.mode_ms[uint8_t(Mode::MAINS)]);
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "supply.h"
+
+static uint16_t estimate_for(uint16_t vcc) {
+    return estimate_vcc([vcc](uint8_t level) { return vdet1_millivolt(level) <= vcc; });
+}
+
+TEST(SupplyTest, EstimateVcc) {
+    EXPECT_EQ(VCC_MILLIVOLT, estimate_for(5000));
+    EXPECT_EQ(4075, estimate_for(4100));
+    EXPECT_EQ(2275, estimate_for(2200));
+    EXPECT_EQ(VDET1_BASE_MILLIVOLT, estimate_for(2000));
+}
+
+TEST(SupplyTest, State) {
+    EXPECT_EQ(SupplyState::OK, supply_state(VCC_MILLIVOLT));
+    EXPECT_EQ(SupplyState::LOW, supply_state(4075));
+    EXPECT_EQ(SupplyState::CRITICAL, supply_state(3475));
+}
+
+TEST(SupplyTest, OnThresholdFollowsSupply) {
+    // 既定の校正値ではブリッジのオン抵抗が0なので、比だけで決まりVccに依らない
+    EXPECT_EQ(to_oversample_scale(ON_THRESHOLD), on_threshold_for(CALIBRATION_DEFAULT, VCC_MILLIVOLT));
+    EXPECT_EQ(to_oversample_scale(ON_THRESHOLD), on_threshold_for(CALIBRATION_DEFAULT, 3700));
+
+    // 開放時の値に比例する
+    Calibration low = { 7800, 0, VCC_MILLIVOLT };
+    EXPECT_EQ(uint16_t(7800 * ON_THRESHOLD / 1023), on_threshold_for(low, VCC_MILLIVOLT));
+
+    // オン抵抗が約10Ωの個体: Vccが下がるとオン抵抗が増えるので閾値が上がる
+    Calibration cal = { 8100, 240, VCC_MILLIVOLT };
+    uint16_t t5000 = on_threshold_for(cal, VCC_MILLIVOLT);
+    uint16_t t4300 = on_threshold_for(cal, 4300);
+    uint16_t t3700 = on_threshold_for(cal, 3700);
+    EXPECT_EQ(uint16_t(8100 * ON_THRESHOLD / 1023), t5000);
+    EXPECT_LT(t5000, t4300);
+    EXPECT_LT(t4300, t3700);
+
+    // 閾値に当たる被測定物の抵抗(R = 閾値での R + R0 から、そのVccでのR0を引く)は保たれる
+    auto dut_ohms = [&](uint16_t t, uint16_t vcc) {
+        double r_total = double(SENSE_OHMS) * t / (cal.open - t);
+        double r0 = double(SENSE_OHMS) * cal.shorted / (cal.open - cal.shorted)
+            * (VCC_MILLIVOLT - BRIDGE_VGS_TH_MILLIVOLT) / (vcc - BRIDGE_VGS_TH_MILLIVOLT);
+        return r_total - r0;
+    };
+    EXPECT_NEAR(dut_ohms(t5000, VCC_MILLIVOLT), dut_ohms(t3700, 3700), 1.0);
+
+    // 低いVccで校正した場合は、公称値に戻ると閾値が下がる
+    Calibration cal_low = { 8100, 240, 4000 };
+    EXPECT_GT(on_threshold_for(cal_low, 4000), on_threshold_for(cal_low, VCC_MILLIVOLT));
+}
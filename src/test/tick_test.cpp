@@ -0,0 +1,20 @@
+#include <gtest/gtest.h>
+#include "tick.h"
+
+TEST(TickTest, Elapsed) {
+    EXPECT_EQ(1000, tick_elapsed(TickMark { 19000, false }, TickMark { 18000, false }));
+    // 途中でアンダーフロー
+    EXPECT_EQ(200, tick_elapsed(TickMark { 100, false }, TickMark { 19900, true }));
+    EXPECT_EQ(20500, tick_elapsed(TickMark { 10000, false }, TickMark { 9500, true }));
+    // 開始時にアンダーフローの要求が残っていた
+    EXPECT_EQ(1001, tick_elapsed(TickMark { 1, true }, TickMark { 19000, true }));
+}
+
+TEST(TickTest, Counts) {
+    EXPECT_EQ(uint32_t(5 * 20000 + 1000), tick_counts(5, TickMark { 18999, false }));
+    // アンダーフローした直後で割り込みがまだ処理されていない: TRJは再設定済み、tick_millisは古い
+    uint32_t before = tick_counts(5, TickMark { 0, false });
+    uint32_t after = tick_counts(5, TickMark { 19990, true });
+    EXPECT_EQ(uint32_t(6 * 20000 + 9), after);
+    EXPECT_LT(before, after);
+}
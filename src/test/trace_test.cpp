@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include "trace.h"
+
+TEST(TraceTest, RecordAndWrap) {
+    TraceBuffer<4> t;
+    t.clear();
+    t.record(TRACE_LOOP, 10);
+    t.record(TRACE_UART_RX, 20);
+    EXPECT_EQ(2, t.count);
+    EXPECT_EQ(TRACE_LOOP, t.ids[t.index(0)]);
+
+    t.record(TRACE_UART_RX | TRACE_END, 30);
+    t.record(TRACE_AD_DONE, 40);
+    t.record(TRACE_CONTACT, 50);
+    EXPECT_EQ(4, t.count);
+    EXPECT_EQ(20, t.stamps[t.index(0)]);
+    EXPECT_EQ(50, t.stamps[t.index(3)]);
+}
+
+TEST(TraceTest, Freeze) {
+    TraceBuffer<4> t;
+    t.clear();
+    t.record(TRACE_LOOP, 10);
+    t.frozen = true;
+    t.record(TRACE_LOOP, 20);
+    EXPECT_EQ(1, t.count);
+}
+
+TEST(TraceTest, Sanitize) {
+    TraceBuffer<4> t;
+    t.head = 0xff;
+    t.count = 0xff;
+    t.sanitize();
+    EXPECT_EQ(3, t.head);
+    EXPECT_EQ(4, t.count);
+}
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include "uart_link.h"
+#include "clock_config.h"
+
+TEST(UartLinkTest, Confirm) {
+    UartLink link;
+    link.request(2, 10, 1000);
+    EXPECT_EQ(LinkState::PENDING, link.state());
+    EXPECT_FALSE(link.confirm(1, 10, 1100));  // 違う速度
+    EXPECT_TRUE(link.confirm(2, 10, 1200));
+    EXPECT_EQ(LinkState::FAST, link.state());
+    EXPECT_FALSE(link.check(10, 5000));
+    EXPECT_EQ(2, link.rate());
+}
+
+TEST(UartLinkTest, ConfirmTimeout) {
+    UartLink link;
+    link.request(1, 0, 1000);
+    EXPECT_FALSE(link.check(0, 1000 + LINK_CONFIRM_MS - 1));
+    EXPECT_TRUE(link.check(0, 1000 + LINK_CONFIRM_MS));
+    EXPECT_EQ(LinkState::DEFAULT, link.state());
+    EXPECT_EQ(0, link.rate());
+    EXPECT_FALSE(link.confirm(1, 0, 2100));  // 戻した後の確認は受け付けない
+}
+
+TEST(UartLinkTest, ErrorFallback) {
+    UartLink link;
+    link.request(3, 254, 0);
+    link.confirm(3, 254, 10);
+    EXPECT_FALSE(link.check(uint8_t(254 + LINK_MAX_ERRORS - 1), 500));
+    EXPECT_FALSE(link.check(uint8_t(254 + LINK_MAX_ERRORS - 1), 10 + LINK_WINDOW_MS));  // 次の窓へ
+    EXPECT_FALSE(link.check(uint8_t(254 + LINK_MAX_ERRORS), 1500));
+    EXPECT_TRUE(link.check(uint8_t(254 + 2 * LINK_MAX_ERRORS - 1), 1600));  // カウンタが一周しても差で見る
+    EXPECT_EQ(LinkState::DEFAULT, link.state());
+}
+
+TEST(UartLinkTest, ExactRates) {
+    EXPECT_TRUE(uart_exact(20000000, 250000));
+    EXPECT_TRUE(uart_exact(20000000, 625000));
+    EXPECT_TRUE(uart_exact(20000000, 1250000));
+    EXPECT_FALSE(uart_exact(20000000, 500000));
+    EXPECT_FALSE(uart_exact(20000000, 115200));
+    EXPECT_FALSE(uart_exact(5000000, 625000));
+}
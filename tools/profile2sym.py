@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Resolve the `Q` command profile dump to symbols.
+
+Usage:
+    profile2sym.py uart.log build/main/univ_tester.map
+    profile2sym.py uart.log build/main/univ_tester.elf [--nm m32c-elf-nm]
+
+The dump holds sample counts per address bucket (src/main/profile.h).
+The tool assumes samples are spread evenly within a bucket. It splits
+each bucket between the functions it overlaps by overlap size, then
+prints the estimated share of each function. Pass --buckets to also list
+the raw buckets and the symbols inside each one.
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+BUCKET_SIZE = 1 << 9  # PROFILE_BUCKET_LOG2
+
+HEADER = re.compile(r"^Q (\d+) (\d+)$")
+BUCKET = re.compile(r"^([0-9a-f]+) (\d+)$")
+MAP_SYMBOL = re.compile(r"^\s+0x([0-9a-f]+)\s+([A-Za-z_.$][\w.$]*)\s*$")
+
+
+def read_dump(lines):
+    """Return (samples, outside, {address: count}) from the last complete dump."""
+    dump = None
+    current = None
+    for line in lines:
+        line = line.strip()
+        if line == "Q END":
+            if current is not None:
+                dump = current
+            current = None
+            continue
+        m = HEADER.match(line)
+        if m:
+            current = (int(m.group(1)), int(m.group(2)), {})
+        elif current is not None:
+            m = BUCKET.match(line)
+            if m:
+                current[2][int(m.group(1), 16)] = int(m.group(2))
+    if dump is None:
+        raise ValueError("no complete profile dump (Q ... Q END) found")
+    return dump
+
+
+def symbols_from_map(path):
+    addrs = {}
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            m = MAP_SYMBOL.match(line)
+            if m:
+                addr = int(m.group(1), 16)
+                # Only code: ROM and the extended area.
+                if addr >= 0x8000:
+                    addrs.setdefault(addr, m.group(2))
+    ordered = sorted(addrs.items())
+    # The map has no sizes; a symbol runs up to the next one.
+    return [(a, (ordered[i + 1][0] if i + 1 < len(ordered) else a + BUCKET_SIZE), name)
+            for i, (a, name) in enumerate(ordered)]
+
+
+def symbols_from_elf(path, nm):
+    out = subprocess.run([nm, "-n", "-S", "--defined-only", path],
+                         check=True, capture_output=True, text=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 4 and parts[2] in "tTwW":
+            addr, size = int(parts[0], 16), int(parts[1], 16)
+            syms.append((addr, addr + max(size, 1), parts[3]))
+    return syms
+
+
+def attribute(buckets, syms, bucket_size):
+    share = {}
+    per_bucket = {}
+    for base, count in buckets.items():
+        end = base + bucket_size
+        inside = [(max(a, base), min(e, end), name) for a, e, name in syms if a < end and base < e]
+        per_bucket[base] = [name for _, _, name in inside]
+        covered = sum(e - a for a, e, _ in inside)
+        if not covered:
+            share["?"] = share.get("?", 0) + count
+            continue
+        for a, e, name in inside:
+            share[name] = share.get(name, 0) + count * (e - a) / covered
+    return share, per_bucket
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("dump", help="UART log containing a Q dump")
+    ap.add_argument("symbols", help="linker map (.map) or ELF (.elf)")
+    ap.add_argument("--nm", default="m32c-elf-nm")
+    ap.add_argument("--bucket", type=int, default=BUCKET_SIZE, help="bucket size in bytes")
+    ap.add_argument("--buckets", action="store_true", help="also list raw buckets")
+    args = ap.parse_args(argv[1:])
+
+    with open(args.dump, encoding="ascii", errors="replace") as f:
+        samples, outside, buckets = read_dump(f)
+
+    if args.symbols.endswith(".map"):
+        syms = symbols_from_map(args.symbols)
+    else:
+        syms = symbols_from_elf(args.symbols, args.nm)
+
+    share, per_bucket = attribute(buckets, syms, args.bucket)
+    total = samples or 1
+    print("%d samples, %d outside the profiled range" % (samples, outside))
+    for name, n in sorted(share.items(), key=lambda kv: -kv[1]):
+        print("%6.1f%% %8.1f  %s" % (100.0 * n / total, n, name))
+
+    if args.buckets:
+        print()
+        for base in sorted(buckets):
+            print("%05x %6d  %s" % (base, buckets[base], " ".join(per_bucket[base])))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
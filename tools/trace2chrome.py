@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Convert the `E` command trace dump into Chrome trace JSON.
+
+Usage:
+    trace2chrome.py [dump.txt] > trace.json
+
+Reads the UART log (a file or stdin), takes the last block between
+"E <count>" and "E END", and writes JSON that chrome://tracing or
+https://ui.perfetto.dev can open.
+
+Event IDs follow src/main/trace.h:
+    0x01-0x3f  instant events
+    0x40-0x7f  start of a span, (id | 0x80) ends it
+"""
+
+import json
+import re
+import sys
+
+TRACE_END = 0x80
+
+NAMES = {
+    0x01: "loop",
+    0x02: "ad_done",
+    0x03: "contact",
+    0x04: "retune",
+    0x05: "sniff_stop",
+    0x06: "sniff_wake",
+    0x07: "fault",
+    0x40: "UART0_TX_intr",
+    0x41: "UART0_RX_intr",
+    0x42: "TIMER_RB_intr",
+    0x43: "WATCHDOG_intr",
+    0x44: "acquire",
+    0x45: "command",
+}
+
+# Spans that run in interrupt context get their own track.
+ISR_IDS = {0x40, 0x41, 0x42, 0x43}
+TID_MAIN = 1
+TID_ISR = 2
+
+# Stamp layout (tick.h now_stamp): high byte = ms mod 256,
+# low byte = progress within the ms in 128 counts of 50 ns.
+US_PER_FRACTION = 128 * 0.05
+WRAP_US = 256 * 1000
+# An interrupt may store its event between the main loop reading and
+# storing a stamp, so allow small steps backwards without unwrapping.
+REORDER_US = 1000
+
+HEADER = re.compile(r"^E (\d+)$")
+EVENT = re.compile(r"^([0-9a-f]{2}) ([0-9a-f]{4})$")
+
+
+def read_dump(lines):
+    """Return [(id, stamp)] from the last complete dump in lines."""
+    dump = None
+    current = None
+    for line in lines:
+        line = line.strip()
+        if line == "E END":
+            if current is not None:
+                dump = current
+            current = None
+        elif HEADER.match(line):
+            current = []
+        elif current is not None:
+            m = EVENT.match(line)
+            if m:
+                current.append((int(m.group(1), 16), int(m.group(2), 16)))
+    if dump is None:
+        raise ValueError("no complete trace dump (E ... E END) found")
+    return dump
+
+
+def stamp_to_us(stamp):
+    return (stamp >> 8) * 1000 + (stamp & 0xff) * US_PER_FRACTION
+
+
+def to_chrome(events):
+    out = [
+        {"name": "thread_name", "ph": "M", "pid": 1, "tid": TID_MAIN,
+         "args": {"name": "main"}},
+        {"name": "thread_name", "ph": "M", "pid": 1, "tid": TID_ISR,
+         "args": {"name": "interrupt"}},
+    ]
+    offset = 0
+    prev = None
+    for eid, stamp in events:
+        raw = stamp_to_us(stamp)
+        if prev is not None and raw + REORDER_US < prev:
+            offset += WRAP_US
+        prev = raw
+
+        base = eid & ~TRACE_END
+        name = NAMES.get(base, "0x%02x" % base)
+        if base < 0x40:
+            ph = "i"
+        else:
+            ph = "E" if eid & TRACE_END else "B"
+        e = {
+            "name": name,
+            "ph": ph,
+            "ts": round(raw + offset, 1),
+            "pid": 1,
+            "tid": TID_ISR if base in ISR_IDS else TID_MAIN,
+        }
+        if ph == "i":
+            e["s"] = "t"
+        out.append(e)
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main(argv):
+    src = open(argv[1], encoding="ascii", errors="replace") if len(argv) > 1 else sys.stdin
+    with src:
+        events = read_dump(src)
+    json.dump(to_chrome(events), sys.stdout, indent=1)
+    sys.stdout.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))